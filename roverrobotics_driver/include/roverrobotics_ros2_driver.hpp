@@ -3,14 +3,20 @@
 #include <tf2/LinearMath/Quaternion.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
 #include <geometry_msgs/msg/transform_stamped.hpp>
 
 
 #include "protocol_pro.hpp"
 #include "protocol_zero_2.hpp"
 #include "differential_robot.hpp"
+#include "protocol_sim.hpp"
+#include "telemetry_exporter.hpp"
 #include "global_error_constants.hpp"
 
 #include "eigen3/Eigen/Dense"
@@ -23,6 +29,8 @@
 #include "std_msgs/msg/bool.hpp"
 #include "std_msgs/msg/float32.hpp"
 #include "sensor_msgs/msg/battery_state.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "sensor_msgs/msg/imu.hpp"
 #include "std_msgs/msg/float32_multi_array.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.hpp"
 #include "tf2_ros/transform_broadcaster.h"
@@ -37,6 +45,8 @@ namespace RoverRobotics {
 class RobotDriver : public rclcpp::Node {
  public:
   RobotDriver();
+  /// Hands librover back to the steady clock before the robot threads stop
+  ~RobotDriver();
 
  private:
   // Default Values
@@ -74,8 +84,50 @@ class RobotDriver : public rclcpp::Node {
   const float WHEEL_RADIUS_DEFAULT_ = 0.08255;
   const float WHEEL_BASE_DEFAULT_ = 0.28575;
   const float ROBOT_LENGTH_DEFAULT_ = 0.2159;
+  const bool DELAY_COMPENSATION_DEFAULT_ = false;
+  const bool IMU_FUSION_DEFAULT_ = false;
+  const std::string IMU_TOPIC_DEFAULT_ = "/imu/data";
+  const float IMU_GYRO_WEIGHT_DEFAULT_ = 0.98;
+  const float IMU_ADAPTATION_RATE_DEFAULT_ = 0.02;
+  const double IMU_TIMEOUT_S_ = 0.1;
+  const float DIAGNOSTICS_FREQUENCY_DEFAULT_ = 1.0;
+  const double TELEMETRY_STALE_TIMEOUT_DEFAULT_ = 0.5;
+  const std::string TELEMETRY_SHM_NAME_DEFAULT_ = "";
+  const float TELEMETRY_SHM_FREQUENCY_DEFAULT_ = 100.0;
+  const std::string EXECUTOR_TYPE_DEFAULT_ = "multi_threaded";
+  const int EXECUTOR_THREADS_DEFAULT_ = 0;
+  // how late a timer callback started and how long it ran, accumulated
+  // between diagnostics messages (ms)
+  struct CallbackTiming {
+    std::string name;
+    std::chrono::steady_clock::time_point last_start{};
+    unsigned int runs = 0;
+    unsigned int delays = 0;
+    double delay_sum = 0;
+    double delay_max = 0;
+    double run_sum = 0;
+    double run_max = 0;
+  };
+  // prioritized velocity command input
+  struct CommandSource {
+    std::string name;
+    std::string topic;
+    int priority;
+    int64_t timeout_ns;
+    double linear_limit;
+    double angular_limit;
+    // sentinel until the first command; under sim time 0 is a valid time
+    static constexpr int64_t NEVER_RECEIVED_NS =
+        std::numeric_limits<int64_t>::min();
+    std::atomic<int64_t> last_command_ns{NEVER_RECEIVED_NS};
+    rclcpp::Subscription<geometry_msgs::msg::Twist>::SharedPtr subscriber;
+  };
+  const double COMMAND_SOURCE_TIMEOUT_DEFAULT_ = 0.5;
   // robot protocol pointer
   std::unique_ptr<BaseProtocolObject> robot_;
+  // shared memory telemetry for non-ROS consumers; declared after robot_ so it
+  // stops before the robot is destroyed
+  std::unique_ptr<TelemetryExporter> telemetry_exporter_;
   // universal robot data structure
   robotData robot_data_ = {};
   Control::pid_gains pid_gains_ = {0, 0, 0};
@@ -90,6 +142,8 @@ class RobotDriver : public rclcpp::Node {
       estop_reset_subscriber_;  // listen to estop reset inputs
   rclcpp::Subscription<std_msgs::msg::Bool>::SharedPtr
       robot_info__request_subscriber_;  // listen to robot_info request
+  rclcpp::Subscription<sensor_msgs::msg::Imu>::SharedPtr
+      imu_subscriber_;  // listen to the accessory imu
 
   rclcpp::Publisher<std_msgs::msg::Float32MultiArray>::SharedPtr
       robot_info_publisher;  // publish robot_unique info
@@ -100,11 +154,16 @@ class RobotDriver : public rclcpp::Node {
    rclcpp::Publisher<sensor_msgs::msg::BatteryState>::SharedPtr
       battery_soc_publisher_;  // Battery Status Publisher
   std::unique_ptr<tf2_ros::TransformBroadcaster> odom_tf_pub; // Odom TF Broadcaster
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr
+      diagnostics_publisher_;  // per-thread cpu usage
 
   // Timepoint / Timer
   rclcpp::Time odom_prev_time_;
   rclcpp::TimerBase::SharedPtr odometry_timer_;
   rclcpp::TimerBase::SharedPtr robot_status_timer_;
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
+  rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr
+      parameter_callback_handle_;
 
   // configurable variables
   std::string speed_topic_;
@@ -123,6 +182,39 @@ class RobotDriver : public rclcpp::Node {
   float robot_length_;
   std::string odom_topic_;
 
+  // command arbitration
+  std::vector<std::unique_ptr<CommandSource>> command_sources_;
+  std::atomic<int> active_command_source_{-1};
+
+  // imu yaw rate fusion
+  bool imu_fusion_enabled_;
+  std::string imu_topic_;
+  std::unique_ptr<Control::YawRateFusion> yaw_fusion_;
+  double imu_yaw_rate_ = 0;
+  double imu_fused_yaw_rate_ = 0;
+  rclcpp::Time imu_last_time_;
+
+  // telemetry older than this is published as NaN and not integrated
+  std::chrono::milliseconds telemetry_stale_timeout_;
+  bool is_stale(const field_stamp &stamp);
+
+  // thread cpu and scheduling diagnostics
+  double diagnostics_frequency_;
+  Utilities::ThreadMonitor thread_monitor_;
+
+  // timer callback delay and run time, to compare executors
+  std::mutex callback_timing_mutex_;
+  CallbackTiming odometry_timing_{"odometry"};
+  CallbackTiming robot_status_timing_{"robot_status"};
+  /**
+   * @brief Run a timer callback and record its delay and run time
+   * @param timing accumulator of the callback
+   * @param period timer period in seconds
+   * @param callback the work of the timer
+   */
+  void time_callback(CallbackTiming &timing, double period,
+                     const std::function<void()> &callback);
+
   // odom
   double odometry_frequency_;
   bool pub_odom_tf_;
@@ -138,6 +230,7 @@ class RobotDriver : public rclcpp::Node {
   float yaw_covariance;
   double linear_top_speed_;
   double angular_top_speed_;
+  bool delay_compensation_;
 
   /**
    * @brief Ros2 Velocity Callback
@@ -145,6 +238,28 @@ class RobotDriver : public rclcpp::Node {
    * @param msg Twist Msg containing linear x y z and angular x y z
    */
   void velocity_event_callback(geometry_msgs::msg::Twist::ConstSharedPtr msg);
+  /**
+   * @brief Prioritized Velocity Callback
+   * Forwards the command only if no higher priority source has commanded
+   * within its timeout, after clipping it to the source's speed limits
+   *
+   * @param source index into command_sources_ of the sending source
+   * @param msg Twist Msg containing linear x y z and angular x y z
+   */
+  void command_source_callback(size_t source,
+                               geometry_msgs::msg::Twist::ConstSharedPtr msg);
+  /**
+   * @brief Parameter Set Event Callback
+   * Validates changes to the pid gains, gain schedule, acceleration limits,
+   * angular scaling, geometric decay, geometry, thermal derating and current
+   * limits, then hands the merged configuration to the robot, which swaps it
+   * in at its next control cycle
+   *
+   * @param parameters the parameters being set
+   * @return successful = false with a reason if the change was rejected
+   */
+  rcl_interfaces::msg::SetParametersResult parameters_event_callback(
+      const std::vector<rclcpp::Parameter> &parameters);
   /**
    * @brief Trim Topic Event Callback
    *
@@ -172,6 +287,18 @@ class RobotDriver : public rclcpp::Node {
    * False Do nothing)
    */
   void robot_info_request_callback(std_msgs::msg::Bool::ConstSharedPtr &msg);
+  /**
+   * @brief Imu Topic Event Callback
+   *
+   * @param msg Imu msg; its z angular velocity is fused with the wheel yaw
+   * rate at the imu rate, and odometry uses the latest fused rate
+   */
+  void imu_event_callback(sensor_msgs::msg::Imu::ConstSharedPtr msg);
+  /**
+   * @brief Check if imu data is recent enough to drive the odometry
+   *
+   */
+  bool imu_is_fresh();
   /**
    * @brief Publish robot status at an interval
    *
@@ -182,6 +309,12 @@ class RobotDriver : public rclcpp::Node {
    *
    */
   void publish_robot_info();
+  /**
+   * @brief Publish cpu time, context switches and wakeups of every thread,
+   * and the delay and run time of the timer callbacks
+   *
+   */
+  void publish_diagnostics();
   /**
    * @brief Publish odom at an interval
    *
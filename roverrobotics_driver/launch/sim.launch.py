@@ -0,0 +1,48 @@
+from pathlib import Path
+
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument
+from launch.conditions import IfCondition
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import Node
+from launch_ros.parameter_descriptions import ParameterValue
+
+
+def generate_launch_description():
+    hardware_config = Path(get_package_share_directory(
+        'roverrobotics_driver'), 'config', 'sim_config.yaml')
+    assert hardware_config.is_file()
+
+    use_sim_time_arg = DeclareLaunchArgument(name='use_sim_time', default_value='true',
+                                             description='Run the driver on the /clock topic')
+    real_time_factor_arg = DeclareLaunchArgument(name='real_time_factor', default_value='1.0',
+                                                 description='Sim seconds per wall second on /clock')
+
+    ld = LaunchDescription()
+
+    robot_driver = Node(
+        package = 'roverrobotics_driver',
+        name = 'roverrobotics_driver',
+        executable = 'roverrobotics_driver',
+        parameters = [hardware_config,
+                      {'use_sim_time': ParameterValue(LaunchConfiguration('use_sim_time'), value_type=bool)}],
+        output='screen'
+    )
+
+    # nothing else publishes /clock for the simulated robot
+    sim_clock = Node(
+        package = 'roverrobotics_driver',
+        name = 'sim_clock',
+        executable = 'sim_clock',
+        parameters = [{'real_time_factor': ParameterValue(LaunchConfiguration('real_time_factor'), value_type=float)}],
+        condition = IfCondition(LaunchConfiguration('use_sim_time')),
+        output='screen'
+    )
+
+    ld.add_action(use_sim_time_arg)
+    ld.add_action(real_time_factor_arg)
+    ld.add_action(robot_driver)
+    ld.add_action(sim_clock)
+
+    return ld
@@ -5,6 +5,7 @@
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <net/if.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,6 +31,7 @@
 
 #include "status_data.hpp"
 #include "utils.hpp"
+#include "utilities.hpp"
 #include "global_error_constants.hpp"
 
 
@@ -38,6 +40,8 @@ class CommBase;
 }
 class RoverRobotics::CommBase {
  public:
+  /* the implementation should stop its read thread and close the device */
+  virtual ~CommBase() = default;
   /*
    * @brief Pure Virtual Interface of Write To Communication Device.
    * The implementation of this function should accept a vector of unsigned
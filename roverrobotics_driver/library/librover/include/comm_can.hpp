@@ -19,6 +19,7 @@ class RoverRobotics::CommCan : public RoverRobotics::CommBase {
    */
   CommCan(const char *device, std::function<void(std::vector<uint8_t>)>,
           std::vector<uint8_t>);
+  ~CommCan();
   /*
    * @brief Write data to Can Device
    * by accepting a vector of unsigned int 32 and convert it to a byte stream
@@ -49,7 +50,10 @@ class RoverRobotics::CommCan : public RoverRobotics::CommBase {
   int Can_port_;
   const int CAN_MSG_SIZE_ = 9;
   std::atomic<bool> is_connected_;
+  std::atomic<bool> running_;
   std::mutex Can_write_mutex_;
   std::thread Can_read_thread_;
   const int TIMEOUT_MS_ = 1000;  // 1 sec timeout
+  /* how often the read loop checks for shutdown while the bus is quiet */
+  const int POLL_TIMEOUT_MS_ = 100;
 };
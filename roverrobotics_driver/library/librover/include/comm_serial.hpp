@@ -19,6 +19,7 @@ class RoverRobotics::CommSerial : public RoverRobotics::CommBase {
    */
   CommSerial(const char *device, std::function<void(std::vector<uint8_t>)>,
              std::vector<uint8_t>);
+  ~CommSerial();
   /*
    * @brief Write data to Serial Device
    * by accepting a vector of unsigned int 32 and convert it to a byte stream
@@ -44,6 +45,9 @@ class RoverRobotics::CommSerial : public RoverRobotics::CommBase {
   int read_size_;
   int serial_port_;
   std::atomic<bool> is_connected_;
+  std::atomic<bool> running_;
   std::thread serial_read_thread_;
   const int TIMEOUT_MS_ = 1000; //1 sec timeout
+  /* how often the read loop checks for shutdown while the device is quiet */
+  const int POLL_TIMEOUT_MS_ = 100;
 };
@@ -1,5 +1,6 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <fstream>
@@ -10,6 +11,8 @@
 #include <string>
 #include <vector>
 
+#include "utilities.hpp"
+
 #ifdef DEBUG
 #include <ctime>
 #include <sstream>
@@ -23,6 +26,13 @@ namespace Control {
 class PidController;
 class SkidRobotMotionController;
 class AlphaBetaFilter;
+class LatencyEstimator;
+class DelayCompensator;
+class YawRateFusion;
+class ThermalModel;
+class ThermalDerating;
+class CurrentLimiter;
+class SigmaDeltaQuantizer;
 
 /* datatypes */
 typedef enum {
@@ -61,6 +71,14 @@ struct robot_geometry {
   float center_of_mass_y_offset;
 };
 
+/* sample sequence number of each wheel's speed */
+struct wheel_sequences {
+  unsigned int fl;
+  unsigned int fr;
+  unsigned int rl;
+  unsigned int rr;
+};
+
 struct pid_gains {
   double kp;
   double ki;
@@ -87,6 +105,79 @@ struct pid_output_limits {
   float negmax;
 };
 
+struct latency_stats {
+  float round_trip_ms;
+  float telemetry_age_ms;
+};
+
+/* pid gains on a grid of wheel speed (m/s) x battery voltage (V); gains are
+ * stored row-major by speed, ie gains[speed_index * voltages + voltage_index].
+ * An empty table disables scheduling. */
+struct gain_schedule {
+  std::vector<float> speed_breakpoints;
+  std::vector<float> voltage_breakpoints;
+  std::vector<pid_gains> gains;
+};
+
+/* first-order thermal model of one heat source (motor winding or mosfets) */
+struct thermal_model_params {
+  float time_constant; /* (S) time to reach 63% of a temperature step */
+  float heating_coef;  /* steady state rise above ambient per amp^2 (C/A^2) */
+  float limit;         /* (C) temperature where the motor controller cuts back */
+};
+
+struct thermal_derating_params {
+  bool enabled;
+  thermal_model_params motor;
+  thermal_model_params mosfet;
+  float ambient;    /* (C) */
+  float horizon;    /* (S) start derating when the limit is closer than this */
+  float min_factor; /* lowest fraction of the max duty cycle ever applied */
+};
+
+struct current_limit_params {
+  bool enabled;
+  float motor_current_budget;   /* (A) per motor, magnitude */
+  float battery_current_budget; /* (A) total drawn from the battery */
+  float max_boost;              /* largest multiple of the acceleration limit */
+  float min_scale;              /* smallest multiple of the acceleration limit */
+};
+
+/* measurements from the drivetrain used to adapt the control each cycle;
+ * currents and temperatures which are not reported (or have gone stale)
+ * should be NaN, a battery voltage that is not known 0 */
+struct drive_telemetry {
+  float battery_voltage;
+  float battery_current;
+  motor_data motor_currents;
+  motor_data motor_temperatures;
+  motor_data mosfet_temperatures;
+};
+
+struct control_config {
+  pid_gains pid;
+  robot_velocities acceleration_limits;
+  angular_scaling_params angular_scaling;
+  float geometric_decay;
+  robot_geometry geometry;
+  gain_schedule schedule;
+  thermal_derating_params thermal;
+  current_limit_params current_limits;
+};
+
+/* parts of a control_config, for robots that apply only some of them */
+typedef enum {
+  CONFIG_PID = 1 << 0,
+  CONFIG_ACCELERATION_LIMITS = 1 << 1,
+  CONFIG_ANGULAR_SCALING = 1 << 2,
+  CONFIG_GEOMETRIC_DECAY = 1 << 3,
+  CONFIG_GEOMETRY = 1 << 4,
+  CONFIG_GAIN_SCHEDULE = 1 << 5,
+  CONFIG_THERMAL = 1 << 6,
+  CONFIG_CURRENT_LIMITS = 1 << 7,
+  CONFIG_ALL = (1 << 8) - 1,
+} control_config_field_t;
+
 /* useful functions */
 
 /*
@@ -136,6 +227,36 @@ robot_velocities scaleAngularCommand(robot_velocities target_velocities,
 robot_velocities computeVelocitiesFromWheelspeeds(
     motor_data wheel_speeds, robot_geometry robot_geometry);
 
+/*
+ * @brief Thermal derating defaults: limits at the VESC cutback start, model
+ * coefficients are conservative starting points to be tuned per robot
+ */
+thermal_derating_params defaultThermalDeratingParams();
+
+/*
+ * @brief Current-aware acceleration defaults (disabled)
+ */
+current_limit_params defaultCurrentLimitParams();
+
+/*
+ * @brief Bilinearly interpolate pid gains from a gain schedule, clamping to
+ * the edges of the table
+ * @param schedule is a non-empty gain schedule
+ * @param wheel_speed is the magnitude of the wheel's surface speed (m/s)
+ * @param battery_voltage is the battery voltage (V); a non-positive value
+ * (not reported yet) uses the highest voltage breakpoint
+ */
+pid_gains interpolateGains(const gain_schedule &schedule, float wheel_speed,
+                           float battery_voltage);
+
+/*
+ * @brief Check that a control configuration is safe to run with
+ * @param config is the proposed configuration
+ * @param reason is set to a human readable explanation when invalid
+ * @return true if every field is within its allowed range
+ */
+bool validateControlConfig(const control_config &config, std::string &reason);
+
 }  // namespace Control
 
 class Control::PidController {
@@ -221,8 +342,328 @@ class Control::PidController {
   float previous_error_;
   float pos_max_output_;
   float neg_max_output_;
-  std::chrono::steady_clock::time_point time_last_;
-  std::chrono::steady_clock::time_point time_origin_;
+  Utilities::RoverClock::time_point time_last_;
+  Utilities::RoverClock::time_point time_origin_;
+};
+
+class Control::LatencyEstimator {
+ public:
+  /* constructors */
+
+  /*
+   * @brief Estimates the round-trip time to a motor controller and the age of
+   * its telemetry from the timing of requests and replies. Safe to use from
+   * separate writer, reader and control threads.
+   * @param smoothing is the weight given to each new round-trip sample
+   * (exponential moving average on the range (0, 1])
+   */
+  LatencyEstimator(float smoothing = 0.1);
+
+  /*
+   * @brief record that a telemetry request was sent to the controller
+   */
+  void markRequest();
+
+  /*
+   * @brief record that telemetry was received from the controller; pairs with
+   * the oldest outstanding request to produce a round-trip sample
+   */
+  void markReply();
+
+  /*
+   * @brief get the smoothed request->reply round-trip time (ms), 0 if unknown
+   */
+  float getRoundTripMs();
+
+  /*
+   * @brief get the time elapsed since the last reply was received (ms)
+   */
+  float getTelemetryAgeMs();
+
+  /*
+   * @brief get both the round-trip time and the telemetry age
+   */
+  latency_stats getStats();
+
+  /*
+   * @brief get the estimated age of the controller's measurement at this
+   * instant (S): time since the reply arrived plus the one-way transfer time
+   */
+  float getMeasurementDelay();
+
+ private:
+  float smoothing_;
+  std::atomic<int64_t> request_ns_;
+  std::atomic<int64_t> reply_ns_;
+  std::atomic<float> round_trip_ms_;
+};
+
+class Control::DelayCompensator {
+ public:
+  /* constructors */
+
+  /*
+   * @brief Predicts the present value of a delayed measurement by
+   * extrapolating its recent rate of change across the delay
+   * @param max_delay is the longest delay (S) that will be extrapolated over;
+   * older measurements are held rather than extrapolated further
+   * @param slope_smoothing is the weight given to each new rate of change
+   * sample (exponential moving average on the range (0, 1]); the difference
+   * of two noisy samples is noisier still
+   */
+  DelayCompensator(float max_delay = 0.25, float slope_smoothing = 0.3);
+
+  /*
+   * @brief feed a measurement and get its delay-compensated estimate
+   * @param measured is the latest (delayed) measurement
+   * @param sequence identifies the sample (ie field_stamp.sequence); the rate
+   * of change is only updated when it changes, so a repeated value is still a
+   * new sample and a held value is not
+   * @param dt is the time (S) since the previous call
+   * @param delay is the age (S) of the measurement
+   */
+  float predict(float measured, unsigned int sequence, float dt, float delay);
+
+  /*
+   * @brief forget the measurement history (ie after a stop)
+   */
+  void reset();
+
+ private:
+  float max_delay_;
+  float slope_smoothing_;
+  bool has_sample_;
+  unsigned int last_sequence_;
+  float last_measured_;
+  float slope_;
+  float elapsed_;
+};
+
+class Control::YawRateFusion {
+ public:
+  /* constructors */
+
+  /*
+   * @brief A complementary filter which blends a gyro yaw rate with the yaw
+   * rate derived from skid-steer wheel speeds. The wheel yaw rate is corrected
+   * by a traction factor which is adapted online from the gyro, so it stays
+   * reasonable across surfaces (carpet vs gravel) when the gyro drops out.
+   * @param gyro_weight is the weight of the gyro in the blend [0, 1]
+   * @param adaptation_rate is how quickly the traction factor and gyro bias
+   * follow the measurements per update [0, 1]
+   * @param min_traction_factor lower bound of the adapted traction factor
+   * @param max_traction_factor upper bound of the adapted traction factor
+   */
+  YawRateFusion(float gyro_weight = 0.98, float adaptation_rate = 0.02,
+                float min_traction_factor = 0.3,
+                float max_traction_factor = 1.5);
+
+  /*
+   * @brief fuse a new gyro sample with the wheel yaw rate
+   * @param gyro_yaw_rate is the gyro z rate (rad/s)
+   * @param wheel_yaw_rate is the yaw rate from the wheels (rad/s), sampled
+   * with the gyro; a smoothed (lagging) rate would bias the traction factor
+   * @param wheel_linear_velocity is the linear velocity from the wheels (m/s),
+   * used to detect standstill for gyro bias estimation
+   * @return the fused yaw rate (rad/s)
+   */
+  float update(float gyro_yaw_rate, float wheel_yaw_rate,
+               float wheel_linear_velocity);
+
+  /*
+   * @brief yaw rate from the wheels alone, corrected by the adapted traction
+   * factor; use when no recent gyro data is available
+   * @param wheel_yaw_rate is the yaw rate from the wheels (rad/s)
+   */
+  float correctWheelYawRate(float wheel_yaw_rate);
+
+  /*
+   * @brief get the current traction factor (gyro yaw rate / wheel yaw rate)
+   */
+  float getTractionFactor();
+
+  /*
+   * @brief get the current gyro bias estimate (rad/s)
+   */
+  float getGyroBias();
+
+  /*
+   * @brief set the weight of the gyro in the blend
+   * @param gyro_weight is on the range [0, 1]
+   */
+  void setGyroWeight(float gyro_weight);
+
+ private:
+  float gyro_weight_;
+  float adaptation_rate_;
+  float min_traction_factor_;
+  float max_traction_factor_;
+  float traction_factor_;
+  float gyro_bias_;
+
+  /* below these rates (rad/s, m/s) the robot is treated as not turning/moving */
+  const float MIN_ADAPTATION_YAW_RATE_ = 0.1;
+  const float STANDSTILL_VELOCITY_ = 0.01;
+};
+
+class Control::ThermalModel {
+ public:
+  /* constructors */
+
+  /*
+   * @brief Tracks the temperature of a heat source driven by current (I^2
+   * heating, first-order cooling to ambient). The estimate is pulled toward
+   * the measured temperature whenever one is available, and predicts how long
+   * until the limit is reached if the present load continues.
+   * @param params time constant, heating coefficient and temperature limit
+   * @param ambient is the temperature (C) the source cools towards
+   * @param correction_rate is the weight of each measurement in the estimate
+   */
+  ThermalModel(thermal_model_params params, float ambient = 25,
+               float correction_rate = 0.1);
+
+  /*
+   * @brief advance the model
+   * @param current is the current through the source (A)
+   * @param measured_temperature is the measured temperature (C), NaN if none
+   * @param dt is the time (S) since the previous call
+   */
+  void update(float current, float measured_temperature, float dt);
+
+  /*
+   * @brief get the estimated temperature (C)
+   */
+  float getTemperature();
+
+  /*
+   * @brief get the predicted time (S) until the limit is reached at the
+   * present average load; infinity if it will never be reached
+   */
+  float getTimeToLimit();
+
+ private:
+  thermal_model_params params_;
+  float ambient_;
+  float correction_rate_;
+  float temperature_;
+  float mean_square_current_;
+  bool initialized_;
+
+  /* (S) averaging window for the load used in the prediction */
+  const float LOAD_AVERAGING_TIME_ = 5;
+};
+
+class Control::ThermalDerating {
+ public:
+  /* constructors */
+
+  /*
+   * @brief Runs a motor and a mosfet ThermalModel per wheel and turns the
+   * shortest predicted time-to-limit into a smoothly varying duty cycle
+   * factor, so the robot slows gradually ahead of the motor controllers' own
+   * abrupt thermal cutback
+   * @param params are the model parameters and derating behaviour
+   */
+  ThermalDerating(thermal_derating_params params);
+
+  /*
+   * @brief advance the models and get the new derating factor
+   * @param telemetry are the latest currents and temperatures
+   * @param dt is the time (S) since the previous call
+   * @return factor on the range [min_factor, 1] to apply to the max duty
+   */
+  float update(const drive_telemetry &telemetry, float dt);
+
+  /*
+   * @brief get the current derating factor [min_factor, 1]
+   */
+  float getDerateFactor();
+
+  /*
+   * @brief get the shortest predicted time (S) until a thermal limit
+   */
+  float getTimeToLimit();
+
+ private:
+  thermal_derating_params params_;
+  std::vector<ThermalModel> motor_models_;
+  std::vector<ThermalModel> mosfet_models_;
+  float derate_factor_;
+  float time_to_limit_;
+
+  /* (S) time constant of the derating factor's response */
+  const float SMOOTHING_TIME_ = 2;
+};
+
+class Control::CurrentLimiter {
+ public:
+  /* constructors */
+
+  /*
+   * @brief Scales the acceleration limits so the motors and battery draw up to
+   * their current budgets and no more: while there is headroom the limits are
+   * boosted, and as the peak motor or battery current exceeds its budget (a
+   * payload, a slope) they are cut back. Reacts quickly to over-current and
+   * recovers slowly.
+   * @param params are the current budgets and scaling bounds
+   */
+  CurrentLimiter(current_limit_params params);
+
+  /*
+   * @brief update the scale from the latest currents
+   * @param telemetry holds the motor and battery currents
+   * @param dt is the time (S) since the previous call
+   * @return multiple to apply to the acceleration limits while speeding up
+   */
+  float update(const drive_telemetry &telemetry, float dt);
+
+  /*
+   * @brief get the current acceleration scale
+   */
+  float getScale();
+
+ private:
+  current_limit_params params_;
+  float scale_;
+
+  /* (S) time constants for cutting back and for recovering */
+  const float ATTACK_TIME_ = 0.05;
+  const float RELEASE_TIME_ = 0.5;
+  /* (A) draw below which a current reading is treated as no information */
+  const float MIN_CURRENT_ = 0.5;
+};
+
+class Control::SigmaDeltaQuantizer {
+ public:
+  /* constructors */
+
+  /*
+   * @brief First-order error-feedback (sigma-delta) quantizer for integer
+   * command interfaces. Each frame carries the rounded command plus the
+   * rounding error left over from previous frames, so the average of the
+   * transmitted integers tracks a fractional command with sub-LSB resolution.
+   * Call once per transmitted frame.
+   * @param min is the lowest integer that may be output
+   * @param max is the highest integer that may be output
+   */
+  SigmaDeltaQuantizer(int min, int max);
+
+  /*
+   * @brief quantize the next frame
+   * @param value is the fractional command
+   * @return the integer to transmit
+   */
+  int quantize(float value);
+
+  /*
+   * @brief drop the accumulated error (ie when commanding a stop)
+   */
+  void reset();
+
+ private:
+  int min_;
+  int max_;
+  float error_;
 };
 
 class Control::SkidRobotMotionController {
@@ -411,6 +852,83 @@ class Control::SkidRobotMotionController {
    */
   angular_scaling_params getAngularScaling();
 
+  /*
+   * @brief stage a complete control configuration (gains, limits, angular
+   * scaling, decay and geometry). It is swapped in atomically at the start of
+   * the next runMotionControl() call, so a cycle never sees a mix of old and
+   * new values. Safe to call from any thread.
+   * @param config is the new configuration, assumed to be validated
+   */
+  void setControlConfig(control_config config);
+
+  /*
+   * @brief get the control configuration; a staged configuration which has
+   * not been applied yet takes precedence over the running one. Safe to call
+   * from any thread as long as the individual setters are only used during
+   * setup.
+   */
+  control_config getControlConfig();
+
+  /*
+   * @brief provide the latest drivetrain measurements used by gain scheduling,
+   * thermal derating and current-aware acceleration; call from the control
+   * thread before runMotionControl
+   * @param telemetry is the latest drive telemetry
+   */
+  void setDriveTelemetry(drive_telemetry telemetry);
+
+  /*
+   * @brief get the factor currently applied to the max duty cycle by thermal
+   * derating (1 when disabled)
+   */
+  float getThermalDerateFactor();
+
+  /*
+   * @brief get the shortest predicted time (S) until a motor or motor
+   * controller reaches its thermal limit (infinity when disabled)
+   */
+  float getThermalTimeToLimit();
+
+  /*
+   * @brief get the multiple currently applied to the acceleration limits by
+   * current-aware limiting (1 when disabled)
+   */
+  float getAccelerationScale();
+
+  /*
+   * @brief enable extrapolation of the measured wheelspeeds over the
+   * measurement delay before they are used by the control loops; safe to call
+   * from any thread, the compensators restart at the next cycle
+   * @param enabled turns the delay compensation stage on or off
+   */
+  void setDelayCompensation(bool enabled);
+
+  /*
+   * @brief get whether delay compensation is enabled
+   */
+  bool getDelayCompensation();
+
+  /*
+   * @brief set the age of the wheelspeed measurements (S) to compensate for;
+   * typically taken from a LatencyEstimator each control cycle. Safe to call
+   * from any thread
+   * @param measurement_delay is the delay between the wheel speed being
+   * sampled by the motor controller and it being used here
+   */
+  void setMeasurementDelay(float measurement_delay);
+
+  /*
+   * @brief get the age of the wheelspeed measurements (S)
+   */
+  float getMeasurementDelay();
+
+  /*
+   * @brief set the telemetry sequence numbers (field_stamp.sequence) of the
+   * wheelspeeds passed to the next runMotionControl; the delay compensation
+   * only takes a new rate of change from a new sample
+   */
+  void setWheelSpeedSequences(wheel_sequences sequences);
+
   /*
    * @brief compute the duty cycles for each motor based on the target, current
    * speed, and current duty cycle
@@ -444,6 +962,8 @@ class Control::SkidRobotMotionController {
   std::unique_ptr<PidController> pid_controller_rr_;
 
   pid_gains pid_gains_;
+  gain_schedule gain_schedule_;
+  drive_telemetry drive_telemetry_;
   robot_velocities measured_velocities_;
 
   float open_loop_max_wheel_rpm_;
@@ -461,13 +981,43 @@ class Control::SkidRobotMotionController {
 
   float geometric_decay_;
 
-  std::chrono::steady_clock::time_point time_last_;
-  std::chrono::steady_clock::time_point time_origin_;
+  Utilities::RoverClock::time_point time_last_;
+  Utilities::RoverClock::time_point time_origin_;
 
   motor_data duty_cycles_;
 
+  std::atomic<bool> delay_compensation_;
+  std::atomic<bool> delay_compensation_restart_;
+  std::atomic<float> measurement_delay_;
+  wheel_sequences wheel_sequences_;
+  DelayCompensator delay_compensator_fl_;
+  DelayCompensator delay_compensator_fr_;
+  DelayCompensator delay_compensator_rl_;
+  DelayCompensator delay_compensator_rr_;
+
+  thermal_derating_params thermal_params_;
+  std::unique_ptr<ThermalDerating> thermal_derating_;
+  std::atomic<float> thermal_derate_factor_;
+  std::atomic<float> thermal_time_to_limit_;
+
+  current_limit_params current_limit_params_;
+  std::unique_ptr<CurrentLimiter> current_limiter_;
+  std::atomic<float> acceleration_scale_;
+
+  /* written by setControlConfig(), consumed by the control loop */
+  std::shared_ptr<control_config> pending_config_;
+  /* the last configuration the control loop swapped in */
+  std::shared_ptr<const control_config> applied_config_;
+
   void initializePids();
 
+  void applyPendingConfig_();
+
+  motor_data compensateDelay_(motor_data current_motor_speeds,
+                              float delta_time);
+
+  pid_gains scheduledGains_(float wheel_rpm);
+
   motor_data computeMotorCommandsDual_(motor_data target_wheel_speeds,
                                        motor_data current_motor_speeds);
 
@@ -38,6 +38,18 @@ class RoverRobotics::DifferentialRobot
                      float robot_length,
                      Control::pid_gains pid,
                      Control::angular_scaling_params angular_scale);
+  /*
+   * @brief Run on an already open communication link (a fake one in tests)
+   * instead of opening a device
+   */
+  DifferentialRobot(std::unique_ptr<CommBase> comm_base,
+                    std::string new_comm,
+                    float wheel_radius,
+                    float wheel_base,
+                    float robot_length,
+                    Control::pid_gains pid,
+                    Control::angular_scaling_params angular_scale);
+  ~DifferentialRobot();
 
   /*
    * @brief Trim Robot Velocity
@@ -53,6 +65,10 @@ class RoverRobotics::DifferentialRobot
    * @param bool accept a estop state
    */
   void send_estop(bool) override;
+  void set_delay_compensation(bool) override;
+  Control::control_config get_control_config() override;
+  void update_control_config(Control::control_config) override;
+  unsigned int supported_control_config() override;
   /*
    * @brief Request Robot Status
    * @return structure of statusData
@@ -100,6 +116,17 @@ class RoverRobotics::DifferentialRobot
   void register_comm_base(const char *device) override;
 
  private:
+  /*
+   * @brief Set up the motion control and data structures; everything except
+   * the communication link and the threads
+   */
+  void initialize(std::string new_comm, float wheel_radius, float wheel_base,
+                  float robot_length, Control::pid_gains pid,
+                  Control::angular_scaling_params angular_scale);
+  /*
+   * @brief Start the write and control threads
+   */
+  void start_threads();
   /*
    * @brief Thread Driven function that will send commands to the robot at set
    * interval
@@ -122,7 +149,8 @@ class RoverRobotics::DifferentialRobot
 
   std::unique_ptr<Utilities::PersistentParams> persistent_params_;
 
-  const std::string ROBOT_PARAM_PATH = strcat(std::getenv("HOME"), "/robot.config");
+  const std::string ROBOT_PARAM_PATH =
+      std::string(std::getenv("HOME")) + "/robot.config";
 
   /* metric units (meters) */
   Control::robot_geometry robot_geometry_;
@@ -148,6 +176,8 @@ class RoverRobotics::DifferentialRobot
   int robotmode_num_ = Control::INDEPENDENT_WHEEL;
 
   const double CONTROL_LOOP_TIMEOUT_MS_ = 400;
+  /* wheel feedback older than this is not used for closed-loop control */
+  const std::chrono::milliseconds TELEMETRY_TIMEOUT_{200};
 
   std::unique_ptr<Control::SkidRobotMotionController> skid_control_;
   std::unique_ptr<CommBase> comm_base_;
@@ -155,6 +185,7 @@ class RoverRobotics::DifferentialRobot
 
   std::thread write_to_robot_thread_;
   std::thread motor_speed_update_thread_;
+  std::atomic<bool> running_;
   std::mutex robotstatus_mutex_;
 
   /* main data structure */
@@ -170,6 +201,9 @@ class RoverRobotics::DifferentialRobot
   Control::angular_scaling_params angular_scaling_params_;
   vesc::BridgedVescArray vescArray_;
 
+  /* request/reply timing per motor controller, indexed by VESC_IDS - 1 */
+  Control::LatencyEstimator vesc_latency_[4];
+
   double vesc_fet_temp_;
   double vesc_motor_temp_;
   float vesc_all_motor_current_;
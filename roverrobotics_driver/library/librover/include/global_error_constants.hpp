@@ -1,2 +1,4 @@
 #define SOCKET_CREATION_ERROR -1
-#define SOCKET_BIND_ERROR -2
\ No newline at end of file
+#define SOCKET_BIND_ERROR -2
+#define SHM_CREATION_ERROR -3
+#define INVALID_FREQUENCY_ERROR -4
\ No newline at end of file
@@ -10,6 +10,8 @@ class BaseProtocolObject;
 }
 class RoverRobotics::BaseProtocolObject {
  public:
+  /* stops the robot's threads; the driver owns robots through this class */
+  virtual ~BaseProtocolObject() = default;
   /*
    * @brief Trim Robot Velocity
    * Modify robot velocity differential (between the left side/right side) with
@@ -36,6 +38,33 @@ class RoverRobotics::BaseProtocolObject {
    * @param controllarray an double array of control in m/s
    */
   virtual void set_robot_velocity(double* controllarray) = 0;
+  /*
+   * @brief Enable Delay Compensation
+   * Extrapolate the wheel speed feedback over the estimated telemetry delay
+   * (poll period, reply transfer and control loop phase) before it is used by
+   * the closed-loop controllers
+   * @param bool true = compensate; false = use telemetry as received
+   */
+  virtual void set_delay_compensation(bool) = 0;
+  /*
+   * @brief Get Control Configuration
+   * @return the pid gains, acceleration limits, angular scaling, output decay
+   * and geometry currently used by the robot's motion control
+   */
+  virtual Control::control_config get_control_config() = 0;
+  /*
+   * @brief Update Control Configuration
+   * Swap a new (validated) control configuration into the running motion
+   * control. It takes effect at the next control cycle without a reconnect.
+   * @param Control::control_config the complete new configuration
+   */
+  virtual void update_control_config(Control::control_config) = 0;
+  /*
+   * @brief Supported Control Configuration
+   * @return mask of the Control::control_config_field_t parts that
+   * update_control_config applies; the others are fixed on this robot
+   */
+  virtual unsigned int supported_control_config() = 0;
   /*
    * @brief Request Robot Status
    * @return structure of statusData
@@ -11,6 +11,7 @@ class RoverRobotics::ProProtocolObject
   ProProtocolObject(const char* device, std::string new_comm_type,
                     Control::robot_motion_mode_t robot_mode,
                     Control::pid_gains pid);
+  ~ProProtocolObject();
   /*
    * @brief Trim Robot Velocity
    * Modify robot velocity differential (between the left side/right side) with
@@ -25,6 +26,11 @@ class RoverRobotics::ProProtocolObject
    * @param bool accept a estop state
    */
   void send_estop(bool) override;
+  void set_delay_compensation(bool) override;
+  Control::control_config get_control_config() override;
+  /* the Pro applies only the pid gains; geometry and limits are built in */
+  void update_control_config(Control::control_config) override;
+  unsigned int supported_control_config() override;
   /*
    * @brief Request Robot Status
    * @return structure of statusData
@@ -99,6 +105,8 @@ class RoverRobotics::ProProtocolObject
   const double odom_angular_coef_ = 1/wheel2wheelDistance;
   const double odom_traction_factor_ = 0.610; // Default for 2WD is 0.9877, 4WD is 0.610, flipper is 0.98
   const double CONTROL_LOOP_TIMEOUT_MS_ = 200;
+  /* wheel feedback older than this is not used for closed-loop control */
+  const std::chrono::milliseconds TELEMETRY_TIMEOUT_{200};
   std::unique_ptr<CommBase> comm_base_;
   std::string comm_type_;
 
@@ -109,6 +117,7 @@ class RoverRobotics::ProProtocolObject
   std::thread fast_data_write_thread_;
   std::thread slow_data_write_thread_;
   std::thread motor_commands_update_thread_;
+  std::atomic<bool> running_;
   bool estop_;
   bool closed_loop_;
   // Motor PID variables
@@ -116,6 +125,14 @@ class RoverRobotics::ProProtocolObject
   OdomControl motor2_control_;
   Control::robot_motion_mode_t robot_mode_;
   Control::pid_gains pid_;
+  // Register request/reply timing and wheel speed delay compensation
+  Control::LatencyEstimator latency_;
+  bool delay_compensation_;
+  Control::DelayCompensator motor1_delay_compensator_;
+  Control::DelayCompensator motor2_delay_compensator_;
+  // Error-feedback dithering of the 8 bit drive commands
+  Control::SigmaDeltaQuantizer motor1_quantizer_{MOTOR_MIN_, MOTOR_MAX_};
+  Control::SigmaDeltaQuantizer motor2_quantizer_{MOTOR_MIN_, MOTOR_MAX_};
 
   enum robot_motors { LEFT_MOTOR, RIGHT_MOTOR, FLIPPER_MOTOR };
 
@@ -0,0 +1,145 @@
+#pragma once
+#include "protocol_base.hpp"
+#include "utilities.hpp"
+
+namespace RoverRobotics {
+class SimulatedProtocolObject;
+}
+
+/*
+ * @brief A robot without hardware: the real skid steer motion control drives
+ * a first order model of the motors instead of a comm port. Both loops run on
+ * Utilities::RoverClock, so with a sim time source installed they step as
+ * fast as the clock is advanced.
+ */
+class RoverRobotics::SimulatedProtocolObject
+    : public RoverRobotics::BaseProtocolObject {
+ public:
+  SimulatedProtocolObject(Control::robot_motion_mode_t robot_mode,
+                          float wheel_radius,
+                          float wheel_base,
+                          float robot_length,
+                          Control::pid_gains pid,
+                          Control::angular_scaling_params angular_scale);
+  ~SimulatedProtocolObject();
+
+  /*
+   * @brief Trim Robot Velocity
+   * Modify robot velocity differential (between the left side/right side) with
+   * the input parameter. Useful to compensate if the robot tends to drift
+   * either left or right while commanded to drive straight.
+   * @param double of velocity offset
+   */
+  void update_drivetrim(double) override;
+  /*
+   * @brief Handle Estop Event
+   * Send an estop event to the robot
+   * @param bool accept a estop state
+   */
+  void send_estop(bool) override;
+  /* the simulated telemetry has no delay; passed on to the motion control */
+  void set_delay_compensation(bool) override;
+  Control::control_config get_control_config() override;
+  void update_control_config(Control::control_config) override;
+  unsigned int supported_control_config() override;
+  /*
+   * @brief Request Robot Status
+   * @return structure of statusData
+   */
+  robotData status_request() override;
+  /*
+   * @brief Request Robot Unique Infomation
+   * @return structure of statusData
+   */
+  robotData info_request() override;
+  /*
+   * @brief Cycle through robot supported modes
+   * @return int of the current mode enum
+   */
+  int cycle_robot_mode() override;
+  /*
+   * @brief Set Robot velocity
+   * @param controllarray an double array of control in m/s
+   */
+  void set_robot_velocity(double *controllarray) override;
+  /*
+   * @brief Unpack bytes from the robot
+   * Nothing is received from a simulated robot
+   * @param std::vector<uin32_t> Bytes stream from the robot
+   */
+  void unpack_comm_response(std::vector<uint8_t>) override;
+  /*
+   * @brief Check if Communication still exist
+   * @return bool always true
+   */
+  bool is_connected() override;
+  /*
+   * @brief No device to connect to
+   * @param device ignored
+   */
+  void register_comm_base(const char *device) override;
+
+ private:
+  /*
+   * @brief Thread Driven function update the robot motors using pid
+   * @param sleeptime sleep time between each cycle
+   */
+  void motors_control_loop(int sleeptime);
+  /*
+   * @brief Thread Driven function that steps the motor model
+   * @param sleeptime sleep time between each step
+   */
+  void simulation_loop(int sleeptime);
+
+  /* metric units (meters) */
+  Control::robot_geometry robot_geometry_;
+
+  const float MOTOR_NEUTRAL_ = 0;
+
+  /* max: 1.0, min: 0.0  */
+  const float MOTOR_MAX_ = .97;
+  const float MOTOR_MIN_ = .02;
+  float geometric_decay_ = .98;
+  float left_trim_ = 1;
+  float right_trim_ = 1;
+
+  /* derivative of acceleration */
+  const float LINEAR_JERK_LIMIT_ = 5;
+
+  /* motor model: wheel rpm at full duty, lag of the wheel speed (s) */
+  const float OPEN_LOOP_MAX_RPM_ = 600;
+  const float MOTOR_TIME_CONSTANT_ = 0.15;
+  /* per motor current at stall and full duty (A) */
+  const float MOTOR_STALL_CURRENT_ = 40;
+  /* battery model: open circuit voltage (V), internal resistance (ohm) */
+  const float BATTERY_VOLTAGE_ = 42;
+  const float BATTERY_RESISTANCE_ = 0.05;
+
+  /* limit to the trim that can be applied */
+  const float MAX_CURVATURE_CORRECTION_ = .15;
+
+  const double CONTROL_LOOP_TIMEOUT_MS_ = 400;
+  /* wheel feedback older than this is not used for closed-loop control */
+  const std::chrono::milliseconds TELEMETRY_TIMEOUT_{200};
+
+  std::unique_ptr<Control::SkidRobotMotionController> skid_control_;
+
+  std::atomic<bool> running_;
+  std::thread motor_speed_update_thread_;
+  std::thread simulation_thread_;
+  std::mutex robotstatus_mutex_;
+
+  /* main data structure */
+  robotData robotstatus_;
+
+  /* duty cycles commanded to, and wheel rpms of, the simulated motors */
+  Control::motor_data motors_speeds_;
+  Control::motor_data wheel_rpms_;
+  double trimvalue_ = 0;
+
+  bool estop_;
+
+  Control::robot_motion_mode_t robot_mode_;
+  Control::pid_gains pid_;
+  Control::angular_scaling_params angular_scaling_params_;
+};
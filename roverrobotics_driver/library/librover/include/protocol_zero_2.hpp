@@ -11,7 +11,8 @@ class RoverRobotics::Zero2ProtocolObject
 {
 private:
   std::unique_ptr<Utilities::PersistentParams> persistent_params_;
-  const std::string ROBOT_PARAM_PATH = strcat(std::getenv("HOME"), "/robot.config");
+  const std::string ROBOT_PARAM_PATH =
+      std::string(std::getenv("HOME")) + "/robot.config";
   Control::robot_geometry robot_geometry_ = {.intra_axle_distance = 0.2794,
                                              .wheel_base = 0.3683,
                                              .wheel_radius = 0.2667,
@@ -28,6 +29,8 @@ private:
   const double odom_angular_coef_ = 2.3;    
   const double odom_traction_factor_ = 0.7; 
   const double CONTROL_LOOP_TIMEOUT_MS_ = 200;
+  /* wheel feedback older than this is not used for closed-loop control */
+  const std::chrono::milliseconds TELEMETRY_TIMEOUT_{200};
   const uint8_t PAYLOAD_BYTE_SIZE_ = 2;
   const uint8_t STOP_BYTE_ = 3;
   const uint8_t MSG_SIZE_ = 5;
@@ -51,6 +54,7 @@ private:
   std::thread write_to_robot_thread_;
   std::thread slow_data_write_thread_;
   std::thread motor_speed_update_thread_;
+  std::atomic<bool> running_;
   bool estop_;
   bool closed_loop_;
   // Motor PID variables
@@ -79,6 +83,10 @@ private:
   uint vesc_dev_id_;
   double vesc_pid_pos_;
 
+  /* request/reply timing per motor controller */
+  Control::LatencyEstimator left_latency_;
+  Control::LatencyEstimator right_latency_;
+
   enum robot_motors
   {
     LEFT_MOTOR = 1,
@@ -143,6 +151,7 @@ public:
   Zero2ProtocolObject(const char *device, std::string new_comm_type,
                       Control::robot_motion_mode_t robot_mode,
                       Control::pid_gains pid, Control::angular_scaling_params angular_scale);
+  ~Zero2ProtocolObject();
   /*
    * @brief Trim Robot Velocity
    * Modify robot velocity differential (between the left side/right side) with
@@ -157,6 +166,10 @@ public:
    * @param bool accept a estop state
    */
   void send_estop(bool) override;
+  void set_delay_compensation(bool) override;
+  Control::control_config get_control_config() override;
+  void update_control_config(Control::control_config) override;
+  unsigned int supported_control_config() override;
   /*
    * @brief Request Robot Status
    * @return structure of statusData
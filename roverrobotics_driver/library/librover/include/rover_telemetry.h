@@ -0,0 +1,74 @@
+#pragma once
+/*
+ * Robot telemetry in a named POSIX shared memory segment, for local processes
+ * that are not ROS nodes. The driver writes a snapshot at a fixed rate under
+ * a sequence lock; readers copy it out without blocking the writer and retry
+ * if they raced a write. Plain C so it can be used from C and C++ alike; link
+ * against librover_telemetry (and rt).
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ROVER_TELEMETRY_DEFAULT_NAME "/rover_telemetry"
+#define ROVER_TELEMETRY_VERSION 1
+
+typedef struct {
+  uint64_t sequence; /* number of snapshots written */
+  int64_t stamp_ns;  /* driver clock (sim time under use_sim_time) */
+
+  /* motors: front left, front right, rear left, rear right */
+  float motor_rpm[4];
+  float motor_current[4];
+  float motor_temp[4];
+  float motor_mos_temp[4];
+  float motor_age_ms[4]; /* since last received; inf if never */
+
+  float battery_voltage[2];
+  float battery_current[2];
+  float battery_soc[2];
+  float battery_temp[2];
+  uint16_t battery_fault_flag[2];
+  float battery_age_ms[2];
+
+  uint16_t robot_firmware;
+  uint16_t robot_fault_flag;
+
+  double linear_vel;  /* m/s, measured */
+  double angular_vel; /* rad/s, measured */
+  double cmd_linear_vel;
+  double cmd_angular_vel;
+
+  float comm_round_trip_ms;
+  float telemetry_age_ms;
+  float thermal_derate_factor;
+  float thermal_time_to_limit;
+  float acceleration_scale;
+} rover_telemetry_snapshot;
+
+typedef struct rover_telemetry rover_telemetry;
+
+/*
+ * Reader. open returns NULL if the segment does not exist or was written by
+ * an incompatible version. read returns 0 on success, -1 before the first
+ * snapshot or if no consistent copy could be taken.
+ */
+rover_telemetry *rover_telemetry_open(const char *name);
+int rover_telemetry_read(rover_telemetry *telemetry,
+                         rover_telemetry_snapshot *snapshot);
+void rover_telemetry_close(rover_telemetry *telemetry);
+
+/*
+ * Writer (one per segment). create makes or resizes the segment; destroy
+ * removes it.
+ */
+rover_telemetry *rover_telemetry_create(const char *name);
+void rover_telemetry_write(rover_telemetry *telemetry,
+                           const rover_telemetry_snapshot *snapshot);
+void rover_telemetry_destroy(rover_telemetry *telemetry);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,31 @@
 #include <chrono>
 #pragma once
 namespace RoverRobotics {
+// When a group of telemetry fields was last received (RoverClock) and how
+// many times; sequence 0 means never
+struct field_stamp {
+  std::chrono::milliseconds time;
+  unsigned int sequence;
+};
+
+inline void stamp_field(field_stamp &stamp, std::chrono::milliseconds now) {
+  stamp.time = now;
+  stamp.sequence++;
+}
+
+// never received, or not refreshed within the timeout
+inline bool is_stale(const field_stamp &stamp, std::chrono::milliseconds now,
+                     std::chrono::milliseconds timeout) {
+  return stamp.sequence == 0 || now - stamp.time > timeout;
+}
+
+// received before but not refreshed within the timeout; telemetry a robot
+// never reports does not count as lost
+inline bool is_lost(const field_stamp &stamp, std::chrono::milliseconds now,
+                    std::chrono::milliseconds timeout) {
+  return stamp.sequence != 0 && now - stamp.time > timeout;
+}
+
 struct robotData {
   // Motor Infos
   signed short int motor1_id;
@@ -56,5 +81,31 @@ struct robotData {
   double cmd_linear_vel;
   double cmd_angular_vel;
   std::chrono::milliseconds cmd_ts;
+
+  // Link Latency Info (worst case across the motor controllers)
+  float comm_round_trip_ms;
+  float telemetry_age_ms;
+
+  // Thermal Derating Info (factor on the max duty cycle, predicted seconds
+  // until the hottest motor or motor controller reaches its limit)
+  float thermal_derate_factor;
+  float thermal_time_to_limit;
+
+  // Current-Aware Acceleration Info (multiple of the acceleration limit)
+  float acceleration_scale;
+
+  // Telemetry Freshness Info, stamped by the decoders
+  field_stamp motor1_stamp;  // speed feedback (and what arrives with it)
+  field_stamp motor2_stamp;
+  field_stamp motor3_stamp;
+  field_stamp motor4_stamp;
+  field_stamp motor1_temp_stamp;  // motor and mosfet temperatures
+  field_stamp motor2_temp_stamp;
+  field_stamp motor3_temp_stamp;
+  field_stamp motor4_temp_stamp;
+  field_stamp battery1_stamp;
+  field_stamp battery2_stamp;
+  field_stamp robot_info_stamp;  // guid, firmware, fault flag, fan speed
+  field_stamp flipper_stamp;
 };
 }  // namespace RoverRobotics
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <thread>
+
+#include "global_error_constants.hpp"
+#include "protocol_base.hpp"
+#include "rover_telemetry.h"
+#include "utilities.hpp"
+
+namespace RoverRobotics {
+class TelemetryExporter;
+}
+
+/*
+ * @brief Copies a robot's status into the shared memory telemetry segment
+ * (rover_telemetry.h) on a dedicated thread at a fixed rate
+ */
+class RoverRobotics::TelemetryExporter {
+ public:
+  /*
+   * @brief create the segment and start exporting
+   * @param robot the robot whose status_request() is exported; must outlive
+   * the exporter
+   * @param name shared memory name, ie "/rover_telemetry"
+   * @param frequency snapshots per second (RoverClock), > 0
+   * @throws INVALID_FREQUENCY_ERROR if the frequency is not positive
+   * @throws SHM_CREATION_ERROR if the segment cannot be created
+   */
+  TelemetryExporter(BaseProtocolObject *robot, const std::string &name,
+                    float frequency);
+  ~TelemetryExporter();
+
+ private:
+  void export_loop_(std::chrono::nanoseconds period);
+  rover_telemetry_snapshot make_snapshot_(const robotData &data);
+
+  BaseProtocolObject *robot_;
+  rover_telemetry *segment_;
+  uint64_t sequence_ = 0;
+  std::atomic<bool> running_;
+  std::thread export_thread_;
+};
@@ -4,8 +4,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <chrono>
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <optional>
@@ -14,6 +18,17 @@
 namespace Utilities {
 /* classes */
 class PersistentParams;
+class RoverClock;
+class ThreadMonitor;
+
+/* structs */
+struct thread_stats;
+
+/*
+ * @brief name the calling thread (shown by top -H, ps and ThreadMonitor);
+ * names are cut to the 15 characters Linux allows
+ */
+void set_thread_name(const std::string &name);
 }  // namespace Utilities
 
 class Utilities::PersistentParams {
@@ -31,4 +46,90 @@ class Utilities::PersistentParams {
   void write_param(std::string key, double value);
   std::optional<double> read_param(std::string key);
 
-};
\ No newline at end of file
+};
+/*
+ * @brief The clock librover schedules and timestamps against. It is a
+ * std::chrono clock that reads steady_clock by default; a different time
+ * source (ie ROS sim time) can be installed so control loops and thread
+ * sleeps follow it. Install the time source before creating a robot.
+ */
+class Utilities::RoverClock {
+ public:
+  using rep = int64_t;
+  using period = std::nano;
+  using duration = std::chrono::nanoseconds;
+  using time_point = std::chrono::time_point<RoverClock>;
+  static constexpr bool is_steady = false;
+
+  struct time_source {
+    /* current time (ns) */
+    std::function<int64_t()> now;
+    /* block the calling thread until the given time (ns); false when the
+     * source can no longer sleep (ie ROS shut down) */
+    std::function<bool(int64_t)> sleep_until;
+  };
+
+  static time_point now();
+  /*
+   * @brief sleep on the current time source
+   * @return false when the time source stopped; loops should exit
+   */
+  static bool sleep_until(time_point time);
+  static bool sleep_for(duration sleeptime);
+
+  /*
+   * @brief replace the time source; thread safe
+   * @param source provides the time and sleeps
+   */
+  static void set_time_source(time_source source);
+
+  /*
+   * @brief go back to steady_clock
+   */
+  static void reset_time_source();
+
+ private:
+  static std::shared_ptr<const time_source> source_;
+};
+
+struct Utilities::thread_stats {
+  std::string name;
+  int tid;
+  /* totals since the thread started */
+  double cpu_time;  // s
+  uint64_t voluntary_switches;
+  uint64_t involuntary_switches;
+  uint64_t wakeups;
+  /* since the previous sample; zero on a thread's first sample */
+  double cpu_percent;      // of one core
+  double run_delay;        // s spent runnable but waiting for a cpu
+  double switches_per_sec; // voluntary + involuntary
+  double wakeups_per_sec;
+};
+
+/*
+ * @brief Samples cpu time, context switches and wakeups of every thread of
+ * this process from /proc/self/task
+ */
+class Utilities::ThreadMonitor {
+ public:
+  ThreadMonitor();
+  /*
+   * @brief read all threads' counters and the rates since the last sample
+   * @return one entry per live thread, ordered by tid
+   */
+  std::vector<thread_stats> sample();
+
+ private:
+  struct counters_ {
+    double cpu_time;
+    double run_delay;
+    uint64_t switches;
+    uint64_t wakeups;
+  };
+  std::optional<thread_stats> read_thread_(int tid, counters_ &counters);
+
+  std::vector<std::pair<int, counters_>> last_counters_;
+  std::chrono::steady_clock::time_point last_sample_;
+  long clock_ticks_;
+};
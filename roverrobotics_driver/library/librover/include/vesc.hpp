@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace vesc 
@@ -16,6 +17,8 @@ namespace vesc
         float voltage;
         float current_in;
         bool dataValid;
+        float temp_fet;
+        float temp_motor;
     } vescChannelStatus;
 
     enum vescPacketFlags : uint32_t 
@@ -43,8 +46,9 @@ namespace vesc
     const float RPM_SCALING_FACTOR = 60.0 / 1000.0;
     const float DUTY_SCALING_FACTOR = 1.0 / 10.0;
     const float CURRENT_SCALING_FACTOR = 1.0 / 10.0;
-    const float CURRENT_IN_SCALING_FACTOR = 100.0;
+    const float CURRENT_IN_SCALING_FACTOR = 1.0 / 10.0;
     const float VOLTAGE_SCALING_FACTOR = 1.0 / 10.0;
+    const float TEMP_SCALING_FACTOR = 1.0 / 10.0;
     const float DUTY_COMMAND_SCALING_FACTOR = 100000.0;
 
     const uint32_t CONTENT_MASK = 0xFFFFFF00;
@@ -69,5 +73,9 @@ class vesc::BridgedVescArray
         std::vector<uint8_t> vescIds_;
         float currentVoltage_;
         float currentAmperage_ = 0.0;
+        /* latest STATUS_4 temperatures by vesc id, reported with STATUS */
+        std::unordered_map<uint8_t, float> fetTemps_;
+        std::unordered_map<uint8_t, float> motorTemps_;
+        std::unordered_map<uint8_t, float> inputCurrents_;
 
 };
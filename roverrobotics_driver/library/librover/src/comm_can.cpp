@@ -3,7 +3,7 @@
 namespace RoverRobotics 
 {
     CommCan::CommCan(const char *device,std::function<void(std::vector<uint8_t>)> parsefunction,std::vector<uint8_t> setting)
-    : is_connected_(false) 
+    : is_connected_(false), running_(true) 
     {
         if ((fd = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0) 
         {
@@ -21,7 +21,17 @@ namespace RoverRobotics
             throw(-2);
         }
         // start read thread
-        Can_read_thread_ = std::thread([this, parsefunction]() { this->read_device_loop(parsefunction); });
+        Can_read_thread_ = std::thread([this, parsefunction]() {
+            Utilities::set_thread_name("rover_can_read");
+            this->read_device_loop(parsefunction);
+        });
+    }
+
+    CommCan::~CommCan()
+    {
+        running_ = false;
+        if (Can_read_thread_.joinable()) Can_read_thread_.join();
+        close(fd);
     }
 
     void CommCan::write_to_device(std::vector<uint8_t> msg) 
@@ -45,9 +55,14 @@ namespace RoverRobotics
     {
         std::chrono::milliseconds time_last = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
         
-        while (true) 
+        while (running_) 
         {
-            int num_bytes = read(fd, &robot_frame, sizeof(robot_frame));
+            struct pollfd readable = {fd, POLLIN, 0};
+            int num_bytes = 0;
+            if (poll(&readable, 1, POLL_TIMEOUT_MS_) > 0) 
+            {
+                num_bytes = read(fd, &robot_frame, sizeof(robot_frame));
+            }
             std::chrono::milliseconds time_now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
             
             if (num_bytes <= 0) 
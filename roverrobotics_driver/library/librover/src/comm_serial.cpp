@@ -54,8 +54,18 @@ CommSerial::CommSerial(const char *device,
     return;
   }
   is_connected_ = false;
+  running_ = true;
   serial_read_thread_ = std::thread(
-      [this, parsefunction]() { this->read_device_loop(parsefunction); });
+      [this, parsefunction]() {
+        Utilities::set_thread_name("rover_serial_rd");
+        this->read_device_loop(parsefunction);
+      });
+}
+
+CommSerial::~CommSerial() {
+  running_ = false;
+  if (serial_read_thread_.joinable()) serial_read_thread_.join();
+  close(serial_port_);
 }
 
 void CommSerial::write_to_device(std::vector<uint8_t> msg) {
@@ -75,9 +85,13 @@ void CommSerial::read_device_loop(
   std::chrono::milliseconds time_last =
       std::chrono::duration_cast<std::chrono::milliseconds>(
           std::chrono::system_clock::now().time_since_epoch());
-  while (true) {
+  while (running_) {
     uint8_t read_buf[read_size_];
-    int num_bytes = read(serial_port_, &read_buf, read_size_);
+    struct pollfd readable = {serial_port_, POLLIN, 0};
+    int num_bytes = 0;
+    if (poll(&readable, 1, POLL_TIMEOUT_MS_) > 0) {
+      num_bytes = read(serial_port_, &read_buf, read_size_);
+    }
     std::chrono::milliseconds time_now =
         std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch());
@@ -52,6 +52,201 @@ robot_velocities computeVelocitiesFromWheelspeeds(
   return returnstruct;
 }
 
+/* locate value between breakpoints[index] and breakpoints[index + 1] */
+static void findBracket(const std::vector<float> &breakpoints, float value,
+                        size_t &index, float &fraction) {
+  if (breakpoints.size() < 2 || value <= breakpoints.front()) {
+    index = 0;
+    fraction = 0;
+  } else if (value >= breakpoints.back()) {
+    index = breakpoints.size() - 2;
+    fraction = 1;
+  } else {
+    index = std::upper_bound(breakpoints.begin(), breakpoints.end(), value) -
+            breakpoints.begin() - 1;
+    fraction = (value - breakpoints[index]) /
+               (breakpoints[index + 1] - breakpoints[index]);
+  }
+}
+
+static pid_gains lerpGains(pid_gains a, pid_gains b, float fraction) {
+  return (pid_gains){.kp = a.kp + (b.kp - a.kp) * fraction,
+                     .ki = a.ki + (b.ki - a.ki) * fraction,
+                     .kd = a.kd + (b.kd - a.kd) * fraction};
+}
+
+pid_gains interpolateGains(const gain_schedule &schedule, float wheel_speed,
+                           float battery_voltage) {
+  const size_t voltages = schedule.voltage_breakpoints.size();
+  if (battery_voltage <= 0) {
+    battery_voltage = schedule.voltage_breakpoints.back();
+  }
+  size_t s0, v0;
+  float s_fraction, v_fraction;
+  findBracket(schedule.speed_breakpoints, wheel_speed, s0, s_fraction);
+  findBracket(schedule.voltage_breakpoints, battery_voltage, v0, v_fraction);
+  size_t s1 = std::min(s0 + 1, schedule.speed_breakpoints.size() - 1);
+  size_t v1 = std::min(v0 + 1, voltages - 1);
+
+  auto &gains = schedule.gains;
+  pid_gains low_speed = lerpGains(gains[s0 * voltages + v0],
+                                  gains[s0 * voltages + v1], v_fraction);
+  pid_gains high_speed = lerpGains(gains[s1 * voltages + v0],
+                                   gains[s1 * voltages + v1], v_fraction);
+  return lerpGains(low_speed, high_speed, s_fraction);
+}
+
+/* moving away from zero in the direction already travelled */
+static bool isSpeedingUp(float target, float measured) {
+  return std::abs(target) > std::abs(measured) && target * measured >= 0;
+}
+
+/* an unlimited (float max) acceleration limit stays finite when boosted */
+static float scaleLimit(float limit, float scale) {
+  return std::min(limit * scale, std::numeric_limits<float>::max());
+}
+
+static bool sameThermalModel(const thermal_model_params &a,
+                             const thermal_model_params &b) {
+  return a.time_constant == b.time_constant &&
+         a.heating_coef == b.heating_coef && a.limit == b.limit;
+}
+
+static bool sameThermalParams(const thermal_derating_params &a,
+                              const thermal_derating_params &b) {
+  return a.enabled == b.enabled && sameThermalModel(a.motor, b.motor) &&
+         sameThermalModel(a.mosfet, b.mosfet) && a.ambient == b.ambient &&
+         a.horizon == b.horizon && a.min_factor == b.min_factor;
+}
+
+static bool sameCurrentLimits(const current_limit_params &a,
+                              const current_limit_params &b) {
+  return a.enabled == b.enabled &&
+         a.motor_current_budget == b.motor_current_budget &&
+         a.battery_current_budget == b.battery_current_budget &&
+         a.max_boost == b.max_boost && a.min_scale == b.min_scale;
+}
+
+thermal_derating_params defaultThermalDeratingParams() {
+  return (thermal_derating_params){
+      .enabled = false,
+      .motor = {.time_constant = 600, .heating_coef = 0.05, .limit = 85},
+      .mosfet = {.time_constant = 60, .heating_coef = 0.02, .limit = 85},
+      .ambient = 25,
+      .horizon = 60,
+      .min_factor = 0.3};
+}
+
+current_limit_params defaultCurrentLimitParams() {
+  return (current_limit_params){.enabled = false,
+                                .motor_current_budget = 20,
+                                .battery_current_budget = 30,
+                                .max_boost = 2,
+                                .min_scale = 0.25};
+}
+
+static bool isIncreasing(const std::vector<float> &breakpoints) {
+  for (size_t i = 0; i < breakpoints.size(); i++) {
+    if (!std::isfinite(breakpoints[i])) return false;
+    if (i > 0 && !(breakpoints[i] > breakpoints[i - 1])) return false;
+  }
+  return true;
+}
+
+bool validateControlConfig(const control_config &config, std::string &reason) {
+  const pid_gains &pid = config.pid;
+  if (!std::isfinite(pid.kp) || !std::isfinite(pid.ki) ||
+      !std::isfinite(pid.kd) || pid.kp < 0 || pid.ki < 0 || pid.kd < 0) {
+    reason = "pid gains must be finite and non-negative";
+    return false;
+  }
+  /* numeric_limits<float>::max() is used for "unlimited" */
+  if (!(config.acceleration_limits.linear_velocity > 0) ||
+      !(config.acceleration_limits.angular_velocity > 0)) {
+    reason = "acceleration limits must be positive";
+    return false;
+  }
+  const angular_scaling_params &scale = config.angular_scaling;
+  if (!std::isfinite(scale.a_coef) || !std::isfinite(scale.b_coef) ||
+      !std::isfinite(scale.c_coef) || !(scale.min_scale_val >= 0) ||
+      !(scale.min_scale_val <= scale.max_scale_val)) {
+    reason =
+        "angular scaling coefficients must be finite and 0 <= min_scale <= "
+        "max_scale";
+    return false;
+  }
+  if (!(config.geometric_decay > 0 && config.geometric_decay <= 1)) {
+    reason = "geometric decay must be on the range (0, 1]";
+    return false;
+  }
+  const robot_geometry &geometry = config.geometry;
+  if (!(geometry.wheel_radius > 0) || !(geometry.wheel_base > 0) ||
+      !(geometry.intra_axle_distance >= 0) ||
+      !std::isfinite(geometry.wheel_radius) ||
+      !std::isfinite(geometry.wheel_base) ||
+      !std::isfinite(geometry.intra_axle_distance)) {
+    reason = "wheel radius and wheel base must be positive";
+    return false;
+  }
+  const thermal_derating_params &thermal = config.thermal;
+  if (thermal.enabled) {
+    for (auto &model : {thermal.motor, thermal.mosfet}) {
+      if (!(model.time_constant > 0) || !(model.heating_coef >= 0) ||
+          !(model.limit > thermal.ambient)) {
+        reason =
+            "thermal models need a positive time constant, a non-negative "
+            "heating coefficient and a limit above ambient";
+        return false;
+      }
+    }
+    if (!(thermal.horizon > 0) ||
+        !(thermal.min_factor > 0 && thermal.min_factor <= 1)) {
+      reason =
+          "thermal derating horizon must be positive and its minimum factor "
+          "on the range (0, 1]";
+      return false;
+    }
+  }
+  const current_limit_params &current = config.current_limits;
+  if (current.enabled &&
+      (!(current.motor_current_budget > 0) ||
+       !(current.battery_current_budget > 0) || !(current.min_scale > 0) ||
+       !(current.min_scale <= 1) || !(current.max_boost >= 1) ||
+       !std::isfinite(current.max_boost))) {
+    reason =
+        "current budgets must be positive and 0 < min_scale <= 1 <= "
+        "max_boost";
+    return false;
+  }
+  const gain_schedule &schedule = config.schedule;
+  if (!schedule.gains.empty() || !schedule.speed_breakpoints.empty() ||
+      !schedule.voltage_breakpoints.empty()) {
+    if (schedule.speed_breakpoints.empty() ||
+        schedule.voltage_breakpoints.empty() ||
+        schedule.gains.size() != schedule.speed_breakpoints.size() *
+                                     schedule.voltage_breakpoints.size()) {
+      reason =
+          "gain schedule needs one set of gains per speed and voltage "
+          "breakpoint pair";
+      return false;
+    }
+    if (!isIncreasing(schedule.speed_breakpoints) ||
+        !isIncreasing(schedule.voltage_breakpoints)) {
+      reason = "gain schedule breakpoints must be strictly increasing";
+      return false;
+    }
+    for (auto &gains : schedule.gains) {
+      if (!std::isfinite(gains.kp) || !std::isfinite(gains.ki) ||
+          !std::isfinite(gains.kd) || gains.kp < 0 || gains.ki < 0 ||
+          gains.kd < 0) {
+        reason = "gain schedule gains must be finite and non-negative";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 robot_velocities limitAcceleration(robot_velocities target_velocities,
                                    robot_velocities measured_velocities,
                                    robot_velocities delta_v_limits, float dt) {
@@ -120,8 +315,8 @@ PidController::PidController(struct pid_gains pid_gains, std::string name)
       integral_error_limit_(std::numeric_limits<float>::max()),
       pos_max_output_(std::numeric_limits<float>::max()),
       neg_max_output_(std::numeric_limits<float>::lowest()),
-      time_last_(std::chrono::steady_clock::now()),
-      time_origin_(std::chrono::steady_clock::now()) {
+      time_last_(Utilities::RoverClock::now()),
+      time_origin_(Utilities::RoverClock::now()) {
   name_ = name;
   kp_ = pid_gains.kp;
   kd_ = pid_gains.kd;
@@ -135,8 +330,8 @@ PidController::PidController(struct pid_gains pid_gains,
       integral_error_(0),
       previous_error_(0),
       integral_error_limit_(std::numeric_limits<float>::max()),
-      time_last_(std::chrono::steady_clock::now()),
-      time_origin_(std::chrono::steady_clock::now()) {
+      time_last_(Utilities::RoverClock::now()),
+      time_origin_(Utilities::RoverClock::now()) {
   name_ = name;
   kp_ = pid_gains.kp;
   kd_ = pid_gains.kd;
@@ -200,8 +395,8 @@ void PidController::writePidDataToCsv(std::ofstream &log_file,
 
 pid_outputs PidController::runControl(float target, float measured) {
   /* current time */
-  std::chrono::steady_clock::time_point time_now =
-      std::chrono::steady_clock::now();
+  Utilities::RoverClock::time_point time_now =
+      Utilities::RoverClock::now();
 
   /* delta time (S) */
   float delta_time =
@@ -253,12 +448,295 @@ pid_outputs PidController::runControl(float target, float measured) {
   return returnstruct;
 }
 
+LatencyEstimator::LatencyEstimator(float smoothing)
+    : smoothing_(smoothing),
+      request_ns_(0),
+      reply_ns_(0),
+      round_trip_ms_(0) {}
+
+static int64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void LatencyEstimator::markRequest() {
+  /* only the oldest outstanding request is timed */
+  int64_t expected = 0;
+  request_ns_.compare_exchange_strong(expected, steadyNowNs());
+}
+
+void LatencyEstimator::markReply() {
+  int64_t now = steadyNowNs();
+  reply_ns_ = now;
+
+  int64_t request = request_ns_.exchange(0);
+  if (request == 0) return;
+
+  float sample = (now - request) / 1.0e6;
+  float previous = round_trip_ms_;
+  round_trip_ms_ = (previous == 0)
+                       ? sample
+                       : previous + smoothing_ * (sample - previous);
+}
+
+float LatencyEstimator::getRoundTripMs() { return round_trip_ms_; }
+
+float LatencyEstimator::getTelemetryAgeMs() {
+  int64_t reply = reply_ns_;
+  if (reply == 0) return std::numeric_limits<float>::infinity();
+  return (steadyNowNs() - reply) / 1.0e6;
+}
+
+latency_stats LatencyEstimator::getStats() {
+  return (latency_stats){.round_trip_ms = getRoundTripMs(),
+                         .telemetry_age_ms = getTelemetryAgeMs()};
+}
+
+float LatencyEstimator::getMeasurementDelay() {
+  float age_ms = getTelemetryAgeMs();
+  if (std::isinf(age_ms)) return 0;
+  return (age_ms + 0.5 * getRoundTripMs()) / 1000.0;
+}
+
+DelayCompensator::DelayCompensator(float max_delay, float slope_smoothing)
+    : max_delay_(max_delay),
+      slope_smoothing_(slope_smoothing),
+      has_sample_(false),
+      last_sequence_(0),
+      last_measured_(0),
+      slope_(0),
+      elapsed_(0) {}
+
+float DelayCompensator::predict(float measured, unsigned int sequence,
+                                float dt, float delay) {
+  elapsed_ += dt;
+
+  /* telemetry usually arrives slower than the control loop runs; only update
+   * the rate of change when a new sample has actually come in */
+  if (sequence != last_sequence_) {
+    if (has_sample_ && elapsed_ > 0) {
+      float sample = (measured - last_measured_) / elapsed_;
+      slope_ += slope_smoothing_ * (sample - slope_);
+    }
+    has_sample_ = true;
+    last_sequence_ = sequence;
+    last_measured_ = measured;
+    elapsed_ = 0;
+  }
+
+  return measured + slope_ * std::clamp(delay, 0.0f, max_delay_);
+}
+
+void DelayCompensator::reset() {
+  has_sample_ = false;
+  last_measured_ = 0;
+  slope_ = 0;
+  elapsed_ = 0;
+}
+
+YawRateFusion::YawRateFusion(float gyro_weight, float adaptation_rate,
+                             float min_traction_factor,
+                             float max_traction_factor)
+    : gyro_weight_(gyro_weight),
+      adaptation_rate_(adaptation_rate),
+      min_traction_factor_(min_traction_factor),
+      max_traction_factor_(max_traction_factor),
+      traction_factor_(1.0),
+      gyro_bias_(0) {}
+
+float YawRateFusion::update(float gyro_yaw_rate, float wheel_yaw_rate,
+                            float wheel_linear_velocity) {
+  /* learn the gyro bias while the wheels say the robot is standing still */
+  if (std::abs(wheel_yaw_rate) < STANDSTILL_VELOCITY_ &&
+      std::abs(wheel_linear_velocity) < STANDSTILL_VELOCITY_) {
+    gyro_bias_ += adaptation_rate_ * (gyro_yaw_rate - gyro_bias_);
+  }
+  float gyro = gyro_yaw_rate - gyro_bias_;
+
+  /* adapt the traction factor while clearly turning in the same direction */
+  if (std::abs(wheel_yaw_rate) > MIN_ADAPTATION_YAW_RATE_ &&
+      std::abs(gyro) > MIN_ADAPTATION_YAW_RATE_ &&
+      std::signbit(wheel_yaw_rate) == std::signbit(gyro)) {
+    float ratio = gyro / wheel_yaw_rate;
+    traction_factor_ = std::clamp(
+        traction_factor_ + adaptation_rate_ * (ratio - traction_factor_),
+        min_traction_factor_, max_traction_factor_);
+  }
+
+  return gyro_weight_ * gyro +
+         (1 - gyro_weight_) * correctWheelYawRate(wheel_yaw_rate);
+}
+
+float YawRateFusion::correctWheelYawRate(float wheel_yaw_rate) {
+  return traction_factor_ * wheel_yaw_rate;
+}
+
+float YawRateFusion::getTractionFactor() { return traction_factor_; }
+
+float YawRateFusion::getGyroBias() { return gyro_bias_; }
+
+void YawRateFusion::setGyroWeight(float gyro_weight) {
+  gyro_weight_ = std::clamp(gyro_weight, 0.0f, 1.0f);
+}
+
+ThermalModel::ThermalModel(thermal_model_params params, float ambient,
+                           float correction_rate)
+    : params_(params),
+      ambient_(ambient),
+      correction_rate_(correction_rate),
+      temperature_(ambient),
+      mean_square_current_(0),
+      initialized_(false) {}
+
+void ThermalModel::update(float current, float measured_temperature,
+                          float dt) {
+  bool measured = std::isfinite(measured_temperature);
+  if (!initialized_ && measured) {
+    temperature_ = measured_temperature;
+    initialized_ = true;
+  }
+  if (!(dt > 0)) return;
+
+  /* heat in is proportional to I^2; while the current is unknown assume the
+   * recent load continues */
+  float heating =
+      std::isfinite(current) ? current * current : mean_square_current_;
+  mean_square_current_ +=
+      (heating - mean_square_current_) * dt / (dt + LOAD_AVERAGING_TIME_);
+
+  /* first-order response toward the steady state of the present load */
+  float steady_state = ambient_ + params_.heating_coef * heating;
+  temperature_ += (steady_state - temperature_) *
+                  std::min(1.0f, dt / params_.time_constant);
+
+  /* keep the estimate honest */
+  if (measured) {
+    temperature_ += correction_rate_ * (measured_temperature - temperature_);
+  }
+}
+
+float ThermalModel::getTemperature() { return temperature_; }
+
+float ThermalModel::getTimeToLimit() {
+  float steady_state = ambient_ + params_.heating_coef * mean_square_current_;
+  if (temperature_ >= params_.limit) return 0;
+  if (steady_state <= params_.limit) {
+    return std::numeric_limits<float>::infinity();
+  }
+  /* solve T(t) = Tss + (T0 - Tss) * e^(-t / tau) for T(t) = limit */
+  return -params_.time_constant * std::log((steady_state - params_.limit) /
+                                           (steady_state - temperature_));
+}
+
+ThermalDerating::ThermalDerating(thermal_derating_params params)
+    : params_(params),
+      derate_factor_(1),
+      time_to_limit_(std::numeric_limits<float>::infinity()) {
+  for (int i = 0; i < 4; i++) {
+    motor_models_.emplace_back(params_.motor, params_.ambient);
+    mosfet_models_.emplace_back(params_.mosfet, params_.ambient);
+  }
+}
+
+float ThermalDerating::update(const drive_telemetry &telemetry, float dt) {
+  const motor_data &current = telemetry.motor_currents;
+  const motor_data &motor_temp = telemetry.motor_temperatures;
+  const motor_data &mosfet_temp = telemetry.mosfet_temperatures;
+  const float currents[4] = {current.fl, current.fr, current.rl, current.rr};
+  const float motor_temps[4] = {motor_temp.fl, motor_temp.fr, motor_temp.rl,
+                                motor_temp.rr};
+  const float mosfet_temps[4] = {mosfet_temp.fl, mosfet_temp.fr,
+                                 mosfet_temp.rl, mosfet_temp.rr};
+
+  /* the hottest component sets the pace for the whole robot */
+  time_to_limit_ = std::numeric_limits<float>::infinity();
+  for (int i = 0; i < 4; i++) {
+    motor_models_[i].update(currents[i], motor_temps[i], dt);
+    mosfet_models_[i].update(currents[i], mosfet_temps[i], dt);
+    time_to_limit_ =
+        std::min({time_to_limit_, motor_models_[i].getTimeToLimit(),
+                  mosfet_models_[i].getTimeToLimit()});
+  }
+
+  /* derate in proportion to how soon the limit will be hit */
+  float target =
+      std::clamp(time_to_limit_ / params_.horizon, params_.min_factor, 1.0f);
+  if (dt > 0) {
+    derate_factor_ +=
+        (target - derate_factor_) * std::min(1.0f, dt / SMOOTHING_TIME_);
+  }
+  return derate_factor_;
+}
+
+float ThermalDerating::getDerateFactor() { return derate_factor_; }
+
+float ThermalDerating::getTimeToLimit() { return time_to_limit_; }
+
+CurrentLimiter::CurrentLimiter(current_limit_params params)
+    : params_(params), scale_(1) {}
+
+float CurrentLimiter::update(const drive_telemetry &telemetry, float dt) {
+  if (!(dt > 0)) return scale_;
+  const motor_data &current = telemetry.motor_currents;
+  /* without current telemetry relax to the configured acceleration limit */
+  if (!std::isfinite(current.fl) || !std::isfinite(current.fr) ||
+      !std::isfinite(current.rl) || !std::isfinite(current.rr) ||
+      !std::isfinite(telemetry.battery_current)) {
+    scale_ += (1 - scale_) * std::min(1.0f, dt / RELEASE_TIME_);
+    return scale_;
+  }
+  float peak_motor_current =
+      std::max({std::abs(current.fl), std::abs(current.fr),
+                std::abs(current.rl), std::abs(current.rr)});
+  float battery_current = std::abs(telemetry.battery_current);
+
+  /* near-zero draw (parked, coasting) says nothing about the load, so relax
+   * to the configured acceleration limit instead of boosting */
+  if (peak_motor_current < MIN_CURRENT_ && battery_current < MIN_CURRENT_) {
+    scale_ += (1 - scale_) * std::min(1.0f, dt / RELEASE_TIME_);
+    return scale_;
+  }
+
+  /* how far the draw can grow (> 1) or must shrink (< 1) */
+  float headroom = params_.max_boost;
+  if (peak_motor_current >= MIN_CURRENT_) {
+    headroom = params_.motor_current_budget / peak_motor_current;
+  }
+  if (battery_current >= MIN_CURRENT_) {
+    headroom =
+        std::min(headroom, params_.battery_current_budget / battery_current);
+  }
+
+  float target = std::clamp(headroom, params_.min_scale, params_.max_boost);
+  float time_constant = target < scale_ ? ATTACK_TIME_ : RELEASE_TIME_;
+  scale_ += (target - scale_) * std::min(1.0f, dt / time_constant);
+  return scale_;
+}
+
+float CurrentLimiter::getScale() { return scale_; }
+
+SigmaDeltaQuantizer::SigmaDeltaQuantizer(int min, int max)
+    : min_(min), max_(max), error_(0) {}
+
+int SigmaDeltaQuantizer::quantize(float value) {
+  float desired = value + error_;
+  int output = std::clamp((int)std::lround(desired), min_, max_);
+  /* carry what this frame could not express; bounded so that saturation does
+   * not wind up */
+  error_ = std::clamp(desired - output, -1.0f, 1.0f);
+  return output;
+}
+
+void SigmaDeltaQuantizer::reset() { error_ = 0; }
+
 SkidRobotMotionController::SkidRobotMotionController() {}
 SkidRobotMotionController::SkidRobotMotionController(
     robot_motion_mode_t operating_mode, robot_geometry robot_geometry,
     float max_motor_duty, float min_motor_duty, float left_trim,
     float right_trim, float open_loop_max_wheel_rpm)
     : log_folder_path_("~/Documents/"),
+      drive_telemetry_({0}),
       duty_cycles_({0}),
       measured_velocities_({0}),
       angular_scaling_params_((angular_scaling_params){.a_coef = 0,
@@ -268,8 +746,17 @@ SkidRobotMotionController::SkidRobotMotionController(
                                                        .max_scale_val = 1.0}),
       max_linear_acceleration_(std::numeric_limits<float>::max()),
       max_angular_acceleration_(std::numeric_limits<float>::max()),
-      time_last_(std::chrono::steady_clock::now()),
-      time_origin_(std::chrono::steady_clock::now()) {
+      time_last_(Utilities::RoverClock::now()),
+      time_origin_(Utilities::RoverClock::now()),
+      delay_compensation_(false),
+      delay_compensation_restart_(false),
+      measurement_delay_(0),
+      wheel_sequences_({0, 0, 0, 0}),
+      thermal_params_(defaultThermalDeratingParams()),
+      thermal_derate_factor_(1),
+      thermal_time_to_limit_(std::numeric_limits<float>::infinity()),
+      current_limit_params_(defaultCurrentLimitParams()),
+      acceleration_scale_(1) {
   open_loop_max_wheel_rpm_ = open_loop_max_wheel_rpm;
   min_motor_duty_ = min_motor_duty;
   max_motor_duty_ = max_motor_duty;
@@ -311,6 +798,7 @@ SkidRobotMotionController::SkidRobotMotionController(
     pid_gains pid_gains, float max_motor_duty, float min_motor_duty,
     float left_trim, float right_trim, float geometric_decay)
     : log_folder_path_("~/Documents/"),
+      drive_telemetry_({0}),
       duty_cycles_({0}),
       measured_velocities_({0}),
       angular_scaling_params_((angular_scaling_params){.a_coef = 0,
@@ -320,8 +808,17 @@ SkidRobotMotionController::SkidRobotMotionController(
                                                        .max_scale_val = 1.0}),
       max_linear_acceleration_(std::numeric_limits<float>::max()),
       max_angular_acceleration_(std::numeric_limits<float>::max()),
-      time_last_(std::chrono::steady_clock::now()),
-      time_origin_(std::chrono::steady_clock::now()) {
+      time_last_(Utilities::RoverClock::now()),
+      time_origin_(Utilities::RoverClock::now()),
+      delay_compensation_(false),
+      delay_compensation_restart_(false),
+      measurement_delay_(0),
+      wheel_sequences_({0, 0, 0, 0}),
+      thermal_params_(defaultThermalDeratingParams()),
+      thermal_derate_factor_(1),
+      thermal_time_to_limit_(std::numeric_limits<float>::infinity()),
+      current_limit_params_(defaultCurrentLimitParams()),
+      acceleration_scale_(1) {
 #ifdef DEBUG
   /*open a log file to store control data*/
   auto t = std::time(nullptr);
@@ -423,7 +920,15 @@ robot_geometry SkidRobotMotionController::getRobotGeometry() {
 }
 
 void SkidRobotMotionController::setPidGains(pid_gains pid_gains) {
+  pid_mutex_.lock();
   pid_gains_ = pid_gains;
+  /* keep the integrators, only the gains of the running pids change */
+  for (auto *pid : {&pid_controller_left_, &pid_controller_right_,
+                    &pid_controller_fl_, &pid_controller_fr_,
+                    &pid_controller_rl_, &pid_controller_rr_}) {
+    if (*pid) (*pid)->setGains(pid_gains);
+  }
+  pid_mutex_.unlock();
 }
 
 pid_gains SkidRobotMotionController::getPidGains() { return pid_gains_; }
@@ -460,6 +965,129 @@ angular_scaling_params SkidRobotMotionController::getAngularScaling() {
   return angular_scaling_params_;
 }
 
+void SkidRobotMotionController::setControlConfig(control_config config) {
+  std::atomic_store(&pending_config_,
+                    std::make_shared<control_config>(config));
+}
+
+control_config SkidRobotMotionController::getControlConfig() {
+  if (auto pending = std::atomic_load(&pending_config_)) return *pending;
+  if (auto applied = std::atomic_load(&applied_config_)) return *applied;
+  /* nothing was swapped in at runtime; the members only hold setup values */
+  return (control_config){.pid = pid_gains_,
+                          .acceleration_limits = getAccelerationLimits(),
+                          .angular_scaling = angular_scaling_params_,
+                          .geometric_decay = geometric_decay_,
+                          .geometry = robot_geometry_,
+                          .schedule = gain_schedule_,
+                          .thermal = thermal_params_,
+                          .current_limits = current_limit_params_};
+}
+
+void SkidRobotMotionController::applyPendingConfig_() {
+  /* stays staged while it is applied, so getControlConfig() never reads a
+   * half applied configuration */
+  auto config = std::atomic_load(&pending_config_);
+  if (!config) return;
+  setPidGains(config->pid);
+  setAccelerationLimits(config->acceleration_limits);
+  setAngularScaling(config->angular_scaling);
+  setOutputDecay(config->geometric_decay);
+  setRobotGeometry(config->geometry);
+  gain_schedule_ = config->schedule;
+  /* the thermal models and the current limiter carry state (temperatures,
+   * derating, scale), so they are only rebuilt when their own params change */
+  if (!sameThermalParams(config->thermal, thermal_params_)) {
+    thermal_params_ = config->thermal;
+    if (thermal_params_.enabled) {
+      thermal_derating_ = std::make_unique<ThermalDerating>(thermal_params_);
+    } else {
+      thermal_derating_.reset();
+      thermal_derate_factor_ = 1;
+      thermal_time_to_limit_ = std::numeric_limits<float>::infinity();
+    }
+  }
+  if (!sameCurrentLimits(config->current_limits, current_limit_params_)) {
+    current_limit_params_ = config->current_limits;
+    if (current_limit_params_.enabled) {
+      current_limiter_ =
+          std::make_unique<CurrentLimiter>(current_limit_params_);
+    } else {
+      current_limiter_.reset();
+      acceleration_scale_ = 1;
+    }
+  }
+  std::atomic_store(&applied_config_,
+                    std::shared_ptr<const control_config>(config));
+  /* a newer configuration staged meanwhile is kept for the next cycle */
+  std::atomic_compare_exchange_strong(&pending_config_, &config,
+                                      std::shared_ptr<control_config>());
+}
+
+float SkidRobotMotionController::getAccelerationScale() {
+  return acceleration_scale_;
+}
+
+float SkidRobotMotionController::getThermalDerateFactor() {
+  return thermal_derate_factor_;
+}
+
+float SkidRobotMotionController::getThermalTimeToLimit() {
+  return thermal_time_to_limit_;
+}
+
+void SkidRobotMotionController::setDriveTelemetry(drive_telemetry telemetry) {
+  drive_telemetry_ = telemetry;
+}
+
+pid_gains SkidRobotMotionController::scheduledGains_(float wheel_rpm) {
+  float wheel_speed =
+      std::abs(wheel_rpm) * RPM_TO_RADS_SEC * robot_geometry_.wheel_radius;
+  return interpolateGains(gain_schedule_, wheel_speed,
+                          drive_telemetry_.battery_voltage);
+}
+
+void SkidRobotMotionController::setDelayCompensation(bool enabled) {
+  /* the compensators belong to the control thread, which restarts them */
+  delay_compensation_restart_ = true;
+  delay_compensation_ = enabled;
+}
+
+bool SkidRobotMotionController::getDelayCompensation() {
+  return delay_compensation_;
+}
+
+void SkidRobotMotionController::setMeasurementDelay(float measurement_delay) {
+  measurement_delay_ = measurement_delay;
+}
+
+float SkidRobotMotionController::getMeasurementDelay() {
+  return measurement_delay_;
+}
+
+void SkidRobotMotionController::setWheelSpeedSequences(
+    wheel_sequences sequences) {
+  wheel_sequences_ = sequences;
+}
+
+motor_data SkidRobotMotionController::compensateDelay_(
+    motor_data current_wheel_speeds, float delta_time) {
+  float delay = measurement_delay_;
+  return (motor_data){
+      .fl = delay_compensator_fl_.predict(current_wheel_speeds.fl,
+                                          wheel_sequences_.fl, delta_time,
+                                          delay),
+      .fr = delay_compensator_fr_.predict(current_wheel_speeds.fr,
+                                          wheel_sequences_.fr, delta_time,
+                                          delay),
+      .rl = delay_compensator_rl_.predict(current_wheel_speeds.rl,
+                                          wheel_sequences_.rl, delta_time,
+                                          delay),
+      .rr = delay_compensator_rr_.predict(current_wheel_speeds.rr,
+                                          wheel_sequences_.rr, delta_time,
+                                          delay)};
+}
+
 motor_data SkidRobotMotionController::computeMotorCommandsDual_(
     motor_data target_wheel_speeds, motor_data current_wheel_speeds) {
   /* average front and rear wheels */
@@ -471,6 +1099,10 @@ motor_data SkidRobotMotionController::computeMotorCommandsDual_(
   /* run pid, 1 per side */
 
   pid_mutex_.lock();
+  if (!gain_schedule_.gains.empty()) {
+    pid_controller_left_->setGains(scheduledGains_(left_magnitude));
+    pid_controller_right_->setGains(scheduledGains_(right_magnitude));
+  }
   pid_outputs l_pid_output =
       pid_controller_left_->runControl(target_wheel_speeds.fl, left_magnitude);
 
@@ -507,6 +1139,12 @@ motor_data SkidRobotMotionController::computeMotorCommandsQuad_(
     motor_data target_wheel_speeds, motor_data current_wheel_speeds) {
   /* run pid, 1 per wheel */
   pid_mutex_.lock();
+  if (!gain_schedule_.gains.empty()) {
+    pid_controller_fl_->setGains(scheduledGains_(current_wheel_speeds.fl));
+    pid_controller_fr_->setGains(scheduledGains_(current_wheel_speeds.fr));
+    pid_controller_rl_->setGains(scheduledGains_(current_wheel_speeds.rl));
+    pid_controller_rr_->setGains(scheduledGains_(current_wheel_speeds.rr));
+  }
   pid_outputs fl_pid_output = pid_controller_fl_->runControl(
       target_wheel_speeds.fl, current_wheel_speeds.fl);
 
@@ -549,14 +1187,11 @@ motor_data SkidRobotMotionController::computeMotorCommandsQuad_(
 motor_data SkidRobotMotionController::clipDutyCycles_(
     motor_data proposed_duties) {
   /* clip extreme duty cycles in either direction (positive or negative) */
-  proposed_duties.fr =
-      std::clamp(proposed_duties.fr, -max_motor_duty_, max_motor_duty_);
-  proposed_duties.fl =
-      std::clamp(proposed_duties.fl, -max_motor_duty_, max_motor_duty_);
-  proposed_duties.rr =
-      std::clamp(proposed_duties.rr, -max_motor_duty_, max_motor_duty_);
-  proposed_duties.rl =
-      std::clamp(proposed_duties.rl, -max_motor_duty_, max_motor_duty_);
+  float max_duty = max_motor_duty_ * thermal_derate_factor_;
+  proposed_duties.fr = std::clamp(proposed_duties.fr, -max_duty, max_duty);
+  proposed_duties.fl = std::clamp(proposed_duties.fl, -max_duty, max_duty);
+  proposed_duties.rr = std::clamp(proposed_duties.rr, -max_duty, max_duty);
+  proposed_duties.rl = std::clamp(proposed_duties.rl, -max_duty, max_duty);
 
   /* enforce minimum magnitude (positive or negative) */
   if (std::abs(proposed_duties.fl) < min_motor_duty_) proposed_duties.fl = 0;
@@ -615,8 +1250,8 @@ motor_data SkidRobotMotionController::runMotionControl(
     robot_velocities velocity_targets, motor_data current_duty_cycles,
     motor_data current_wheel_speeds) {
   /* take the time*/
-  std::chrono::steady_clock::time_point time_now =
-      std::chrono::steady_clock::now();
+  Utilities::RoverClock::time_point time_now =
+      Utilities::RoverClock::now();
 
   /* delta time (S) */
   float delta_time =
@@ -627,6 +1262,27 @@ motor_data SkidRobotMotionController::runMotionControl(
 
   time_last_ = time_now;
 
+  /* pick up a reconfiguration at the cycle boundary */
+  applyPendingConfig_();
+
+  /* back off the duty limit ahead of a thermal cutback */
+  if (thermal_derating_) {
+    thermal_derate_factor_ =
+        thermal_derating_->update(drive_telemetry_, delta_time);
+    thermal_time_to_limit_ = thermal_derating_->getTimeToLimit();
+  }
+
+  /* predict where the (delayed) wheelspeeds are now */
+  if (delay_compensation_restart_.exchange(false)) {
+    delay_compensator_fl_.reset();
+    delay_compensator_fr_.reset();
+    delay_compensator_rl_.reset();
+    delay_compensator_rr_.reset();
+  }
+  if (delay_compensation_) {
+    current_wheel_speeds = compensateDelay_(current_wheel_speeds, delta_time);
+  }
+
   /* get estimated robot velocities */
   measured_velocities_ =
       computeVelocitiesFromWheelspeeds(current_wheel_speeds, robot_geometry_);
@@ -636,6 +1292,22 @@ motor_data SkidRobotMotionController::runMotionControl(
   robot_velocities acceleration_limits = {max_linear_acceleration_,
                                           max_angular_acceleration_};
 
+  /* speed up only as hard as the current budgets allow; braking is untouched */
+  if (current_limiter_) {
+    acceleration_scale_ =
+        current_limiter_->update(drive_telemetry_, delta_time);
+    if (isSpeedingUp(velocity_targets.linear_velocity,
+                     measured_velocities_.linear_velocity)) {
+      acceleration_limits.linear_velocity =
+          scaleLimit(acceleration_limits.linear_velocity, acceleration_scale_);
+    }
+    if (isSpeedingUp(velocity_targets.angular_velocity,
+                     measured_velocities_.angular_velocity)) {
+      acceleration_limits.angular_velocity = scaleLimit(
+          acceleration_limits.angular_velocity, acceleration_scale_);
+    }
+  }
+
   velocity_commands = limitAcceleration(velocity_targets, measured_velocities_,
                                         acceleration_limits, delta_time);
 
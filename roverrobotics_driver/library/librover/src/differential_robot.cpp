@@ -7,7 +7,40 @@ DifferentialRobot::DifferentialRobot(const char *device,
                                      float robot_length,
                                      Control::pid_gains pid,
                                      Control::angular_scaling_params angular_scale) {
+  initialize(new_comm, wheel_radius, wheel_base, robot_length, pid,
+             angular_scale);
 
+  /* set up the comm port */
+  register_comm_base(device);
+
+  start_threads();
+}
+
+DifferentialRobot::DifferentialRobot(std::unique_ptr<CommBase> comm_base,
+                                     std::string new_comm,
+                                     float wheel_radius,
+                                     float wheel_base,
+                                     float robot_length,
+                                     Control::pid_gains pid,
+                                     Control::angular_scaling_params angular_scale) {
+  initialize(new_comm, wheel_radius, wheel_base, robot_length, pid,
+             angular_scale);
+  comm_base_ = std::move(comm_base);
+  start_threads();
+}
+
+DifferentialRobot::~DifferentialRobot() {
+  running_ = false;
+  if (write_to_robot_thread_.joinable()) write_to_robot_thread_.join();
+  if (motor_speed_update_thread_.joinable()) motor_speed_update_thread_.join();
+  // stop the reader before the status members it writes are destroyed
+  comm_base_.reset();
+}
+
+void DifferentialRobot::initialize(std::string new_comm, float wheel_radius,
+                                   float wheel_base, float robot_length,
+                                   Control::pid_gains pid,
+                                   Control::angular_scaling_params angular_scale) {
 
   /* create object to load/store persistent parameters (ie trim) */
   persistent_params_ = std::make_unique<Utilities::PersistentParams>(ROBOT_PARAM_PATH);
@@ -58,18 +91,25 @@ DifferentialRobot::DifferentialRobot(const char *device,
   skid_control_->setAccelerationLimits(
           {LINEAR_JERK_LIMIT_, 30.0});
   skid_control_->setAngularScaling(angular_scaling_params_);
+}
 
-  /* set up the comm port */
-  register_comm_base(device);
+void DifferentialRobot::start_threads() {
+  running_ = true;
 
   /* create a dedicated write thread to send commands to the robot on fixed
    * interval */
-  write_to_robot_thread_ = std::thread([this]() { this->send_command(10); });
+  write_to_robot_thread_ = std::thread([this]() {
+    Utilities::set_thread_name("rover_write");
+    this->send_command(10);
+  });
 
   /* create a dedicate thread to compute the desired robot motion, runs on fixed
    * interval */
   motor_speed_update_thread_ =
-      std::thread([this]() { this->motors_control_loop(30); });
+      std::thread([this]() {
+        Utilities::set_thread_name("rover_control");
+        this->motors_control_loop(30);
+      });
 }
 
 void DifferentialRobot::send_estop(bool estop) {
@@ -78,6 +118,22 @@ void DifferentialRobot::send_estop(bool estop) {
   robotstatus_mutex_.unlock();
 }
 
+void DifferentialRobot::set_delay_compensation(bool enable) {
+  skid_control_->setDelayCompensation(enable);
+}
+
+Control::control_config DifferentialRobot::get_control_config() {
+  return skid_control_->getControlConfig();
+}
+
+void DifferentialRobot::update_control_config(Control::control_config config) {
+  skid_control_->setControlConfig(config);
+}
+
+unsigned int DifferentialRobot::supported_control_config() {
+  return Control::CONFIG_ALL;
+}
+
 robotData DifferentialRobot::status_request() { 
   robotstatus_mutex_.lock();
   auto returnData = robotstatus_;
@@ -94,7 +150,7 @@ void DifferentialRobot::set_robot_velocity(double *control_array) {
   robotstatus_.cmd_linear_vel = control_array[0];
   robotstatus_.cmd_angular_vel = control_array[1];
   robotstatus_.cmd_ts = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::system_clock::now().time_since_epoch());
+      Utilities::RoverClock::now().time_since_epoch());
   robotstatus_mutex_.unlock();
 }
 
@@ -102,27 +158,56 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
   if (comm_type_ == "CAN") {
     auto parsedMsg = vescArray_.parseReceivedMessage(robotmsg);
     if (parsedMsg.dataValid) {
+      if (parsedMsg.vescId >= VESC_IDS::FRONT_LEFT &&
+          parsedMsg.vescId <= VESC_IDS::BACK_RIGHT)
+        vesc_latency_[parsedMsg.vescId - 1].markReply();
+      auto received = std::chrono::duration_cast<std::chrono::milliseconds>(
+          Utilities::RoverClock::now().time_since_epoch());
       robotstatus_mutex_.lock();
       switch (parsedMsg.vescId) {
         case (VESC_IDS::FRONT_LEFT):
           robotstatus_.motor1_rpm = parsedMsg.rpm;
           robotstatus_.motor1_id = parsedMsg.vescId;
           robotstatus_.motor1_current = parsedMsg.current;
+          stamp_field(robotstatus_.motor1_stamp, received);
+          if (!std::isnan(parsedMsg.temp_motor)) {
+            robotstatus_.motor1_temp = parsedMsg.temp_motor;
+            robotstatus_.motor1_mos_temp = parsedMsg.temp_fet;
+            stamp_field(robotstatus_.motor1_temp_stamp, received);
+          }
           break;
         case (VESC_IDS::FRONT_RIGHT):
           robotstatus_.motor2_rpm = parsedMsg.rpm;
           robotstatus_.motor2_id = parsedMsg.vescId;
           robotstatus_.motor2_current = parsedMsg.current;
+          stamp_field(robotstatus_.motor2_stamp, received);
+          if (!std::isnan(parsedMsg.temp_motor)) {
+            robotstatus_.motor2_temp = parsedMsg.temp_motor;
+            robotstatus_.motor2_mos_temp = parsedMsg.temp_fet;
+            stamp_field(robotstatus_.motor2_temp_stamp, received);
+          }
           break;
         case (VESC_IDS::BACK_LEFT):
           robotstatus_.motor3_rpm = parsedMsg.rpm;
           robotstatus_.motor3_id = parsedMsg.vescId;
           robotstatus_.motor3_current = parsedMsg.current;
+          stamp_field(robotstatus_.motor3_stamp, received);
+          if (!std::isnan(parsedMsg.temp_motor)) {
+            robotstatus_.motor3_temp = parsedMsg.temp_motor;
+            robotstatus_.motor3_mos_temp = parsedMsg.temp_fet;
+            stamp_field(robotstatus_.motor3_temp_stamp, received);
+          }
           break;
         case (VESC_IDS::BACK_RIGHT):
           robotstatus_.motor4_rpm = parsedMsg.rpm;
           robotstatus_.motor4_id = parsedMsg.vescId;
           robotstatus_.motor4_current = parsedMsg.current;
+          stamp_field(robotstatus_.motor4_stamp, received);
+          if (!std::isnan(parsedMsg.temp_motor)) {
+            robotstatus_.motor4_temp = parsedMsg.temp_motor;
+            robotstatus_.motor4_mos_temp = parsedMsg.temp_fet;
+            stamp_field(robotstatus_.motor4_temp_stamp, received);
+          }
           break;
         default:
           break;
@@ -137,6 +222,7 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
       } else {
         robotstatus_.battery1_SOC = 12.5 * parsedMsg.voltage - 425;
       }
+      stamp_field(robotstatus_.battery1_stamp, received);
       robotstatus_mutex_.unlock();
     }
   } else if (comm_type_ == "SERIAL") {
@@ -269,6 +355,11 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
       std::cerr << std::flush;
       msgqueue.clear();
       // msgqueue.resize(0);
+      if (vesc_dev_id_ >= VESC_IDS::FRONT_LEFT &&
+          vesc_dev_id_ <= VESC_IDS::BACK_RIGHT)
+        vesc_latency_[vesc_dev_id_ - 1].markReply();
+      auto received = std::chrono::duration_cast<std::chrono::milliseconds>(
+          Utilities::RoverClock::now().time_since_epoch());
       switch (vesc_dev_id_) {
           case (VESC_IDS::FRONT_LEFT):
             robotstatus_.motor1_id = vesc_dev_id_;
@@ -276,6 +367,8 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
             robotstatus_.motor1_rpm = vesc_rpm_ * VESC_RPM_SCALING_FACTOR;
             robotstatus_.motor1_temp = vesc_motor_temp_;
             robotstatus_.motor1_mos_temp = vesc_fet_temp_;
+            stamp_field(robotstatus_.motor1_stamp, received);
+            stamp_field(robotstatus_.motor1_temp_stamp, received);
             break;
           case (VESC_IDS::FRONT_RIGHT):
             robotstatus_.motor2_id = vesc_dev_id_;
@@ -283,6 +376,8 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
             robotstatus_.motor2_rpm = vesc_rpm_ * VESC_RPM_SCALING_FACTOR;
             robotstatus_.motor2_temp = vesc_motor_temp_;
             robotstatus_.motor2_mos_temp = vesc_fet_temp_;
+            stamp_field(robotstatus_.motor2_stamp, received);
+            stamp_field(robotstatus_.motor2_temp_stamp, received);
             break;
           case (VESC_IDS::BACK_LEFT):
             robotstatus_.motor3_id = vesc_dev_id_;
@@ -290,6 +385,8 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
             robotstatus_.motor3_rpm = vesc_rpm_ * VESC_RPM_SCALING_FACTOR;
             robotstatus_.motor3_temp = vesc_motor_temp_;
             robotstatus_.motor3_mos_temp = vesc_fet_temp_;
+            stamp_field(robotstatus_.motor3_stamp, received);
+            stamp_field(robotstatus_.motor3_temp_stamp, received);
             break;
           case (VESC_IDS::BACK_RIGHT):
             robotstatus_.motor4_id = vesc_dev_id_;
@@ -297,6 +394,8 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
             robotstatus_.motor4_rpm = vesc_rpm_ * VESC_RPM_SCALING_FACTOR;
             robotstatus_.motor4_temp = vesc_motor_temp_;
             robotstatus_.motor4_mos_temp = vesc_fet_temp_;
+            stamp_field(robotstatus_.motor4_stamp, received);
+            stamp_field(robotstatus_.motor4_temp_stamp, received);
             break;
           default:
             break;
@@ -315,6 +414,7 @@ void DifferentialRobot::unpack_comm_response(std::vector<uint8_t> robotmsg) {
       } else {
         robotstatus_.battery1_SOC = 12.5 * robotstatus_.battery1_voltage - 425;
       }
+      stamp_field(robotstatus_.battery1_stamp, received);
       robotstatus_.battery2_SOC = 0;
       robotstatus_.battery1_fault_flag = 0;
       robotstatus_.battery2_fault_flag = 0;
@@ -381,7 +481,7 @@ void DifferentialRobot::register_comm_base(const char *device) {
 }
 
 void DifferentialRobot::send_command(int sleeptime) {
-  while (true) {
+  while (running_) {
     if (comm_type_ == "SERIAL") {
       unsigned char *payloadptr;
       uint16_t crc;
@@ -397,6 +497,7 @@ void DifferentialRobot::send_command(int sleeptime) {
       write_buffer.push_back(static_cast<uint8_t>(crc & 0xFF));
       write_buffer.push_back(STOP_BYTE_);
       comm_base_->write_to_device(write_buffer);
+      vesc_latency_[BACK_RIGHT - 1].markRequest();
       robotstatus_mutex_.unlock();
 
       robotstatus_mutex_.lock();
@@ -414,6 +515,7 @@ void DifferentialRobot::send_command(int sleeptime) {
       write_buffer.push_back(static_cast<uint8_t>(crc & 0xFF));
       write_buffer.push_back(STOP_BYTE_);
       comm_base_->write_to_device(write_buffer);
+      vesc_latency_[FRONT_LEFT - 1].markRequest();
       robotstatus_mutex_.unlock();
 
       robotstatus_mutex_.lock();
@@ -431,6 +533,7 @@ void DifferentialRobot::send_command(int sleeptime) {
       write_buffer.push_back(static_cast<uint8_t>(crc & 0xFF));
       write_buffer.push_back(STOP_BYTE_);
       comm_base_->write_to_device(write_buffer);
+      vesc_latency_[FRONT_RIGHT - 1].markRequest();
       robotstatus_mutex_.unlock();
 
       robotstatus_mutex_.lock();
@@ -448,6 +551,7 @@ void DifferentialRobot::send_command(int sleeptime) {
       write_buffer.push_back(static_cast<uint8_t>(crc & 0xFF));
       write_buffer.push_back(STOP_BYTE_);
       comm_base_->write_to_device(write_buffer);
+      vesc_latency_[BACK_LEFT - 1].markRequest();
       robotstatus_mutex_.unlock();
 
     } else if (comm_type_ == "CAN") {
@@ -479,7 +583,8 @@ void DifferentialRobot::send_command(int sleeptime) {
     }
     
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleeptime));
+    if (!Utilities::RoverClock::sleep_for(std::chrono::milliseconds(sleeptime)))
+      return;
   }
 }
 
@@ -523,13 +628,14 @@ void DifferentialRobot::motors_control_loop(int sleeptime) {
   float linear_vel_target, angular_vel_target, rpm_FL, rpm_FR, rpm_BL, rpm_BR;
   std::chrono::milliseconds time_last =
       std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::system_clock::now().time_since_epoch());
+          Utilities::RoverClock::now().time_since_epoch());
   std::chrono::milliseconds time_from_msg;
+  Control::drive_telemetry drive_telemetry = {0};
 
-  while (true) {
+  while (running_) {
     std::chrono::milliseconds time_now =
         std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch());
+            Utilities::RoverClock::now().time_since_epoch());
 
     /* collect user commands and various status */
     robotstatus_mutex_.lock();
@@ -539,11 +645,68 @@ void DifferentialRobot::motors_control_loop(int sleeptime) {
     rpm_FR = robotstatus_.motor2_rpm;
     rpm_BL = robotstatus_.motor3_rpm;
     rpm_BR = robotstatus_.motor4_rpm;
+    skid_control_->setWheelSpeedSequences(
+        {robotstatus_.motor1_stamp.sequence, robotstatus_.motor2_stamp.sequence,
+         robotstatus_.motor3_stamp.sequence,
+         robotstatus_.motor4_stamp.sequence});
     time_from_msg = robotstatus_.cmd_ts;
+    /* telemetry that stopped arriving is unknown rather than its last value */
+    bool motor_lost[4] = {
+        is_lost(robotstatus_.motor1_stamp, time_now, TELEMETRY_TIMEOUT_),
+        is_lost(robotstatus_.motor2_stamp, time_now, TELEMETRY_TIMEOUT_),
+        is_lost(robotstatus_.motor3_stamp, time_now, TELEMETRY_TIMEOUT_),
+        is_lost(robotstatus_.motor4_stamp, time_now, TELEMETRY_TIMEOUT_)};
+    bool battery_lost =
+        is_lost(robotstatus_.battery1_stamp, time_now, TELEMETRY_TIMEOUT_);
+    drive_telemetry.battery_voltage =
+        battery_lost ? 0 : robotstatus_.battery1_voltage;
+    drive_telemetry.battery_current =
+        battery_lost ? NAN : robotstatus_.battery1_current;
+    drive_telemetry.motor_currents = {
+        motor_lost[0] ? NAN : robotstatus_.motor1_current,
+        motor_lost[1] ? NAN : robotstatus_.motor2_current,
+        motor_lost[2] ? NAN : robotstatus_.motor3_current,
+        motor_lost[3] ? NAN : robotstatus_.motor4_current};
+    /* temperatures that were never reported or went stale are unknown */
+    bool temp_stale[] = {
+        is_stale(robotstatus_.motor1_temp_stamp, time_now, TELEMETRY_TIMEOUT_),
+        is_stale(robotstatus_.motor2_temp_stamp, time_now, TELEMETRY_TIMEOUT_),
+        is_stale(robotstatus_.motor3_temp_stamp, time_now, TELEMETRY_TIMEOUT_),
+        is_stale(robotstatus_.motor4_temp_stamp, time_now, TELEMETRY_TIMEOUT_)};
+    drive_telemetry.motor_temperatures = {
+        temp_stale[0] ? NAN : robotstatus_.motor1_temp,
+        temp_stale[1] ? NAN : robotstatus_.motor2_temp,
+        temp_stale[2] ? NAN : robotstatus_.motor3_temp,
+        temp_stale[3] ? NAN : robotstatus_.motor4_temp};
+    drive_telemetry.mosfet_temperatures = {
+        temp_stale[0] ? NAN : robotstatus_.motor1_mos_temp,
+        temp_stale[1] ? NAN : robotstatus_.motor2_mos_temp,
+        temp_stale[2] ? NAN : robotstatus_.motor3_mos_temp,
+        temp_stale[3] ? NAN : robotstatus_.motor4_mos_temp};
     robotstatus_mutex_.unlock();
+    bool feedback_lost = std::any_of(std::begin(motor_lost),
+                                     std::end(motor_lost),
+                                     [](bool lost) { return lost; });
+    if (skid_control_->getOperatingMode() == Control::OPEN_LOOP)
+      feedback_lost = false;
+    skid_control_->setDriveTelemetry(drive_telemetry);
+
+    /* the wheelspeeds are as old as the slowest motor controller's telemetry */
+    float measurement_delay = 0;
+    Control::latency_stats latency = {0, 0};
+    for (auto &vesc_latency : vesc_latency_) {
+      auto stats = vesc_latency.getStats();
+      latency.round_trip_ms = std::max(latency.round_trip_ms, stats.round_trip_ms);
+      latency.telemetry_age_ms =
+          std::max(latency.telemetry_age_ms, stats.telemetry_age_ms);
+      measurement_delay =
+          std::max(measurement_delay, vesc_latency.getMeasurementDelay());
+    }
+    skid_control_->setMeasurementDelay(measurement_delay);
 
-    /* compute motion targets if no estop and data is not stale */
-    if (!estop_ &&
+    /* compute motion targets if no estop and data is not stale; without wheel
+     * feedback the closed loop would act on old speeds, so stop instead */
+    if (!estop_ && !feedback_lost &&
         (time_now - time_from_msg).count() <= CONTROL_LOOP_TIMEOUT_MS_) {
       
       /* compute motion targets (not using duty cycle input ATM) */
@@ -568,6 +731,13 @@ void DifferentialRobot::motors_control_loop(int sleeptime) {
       motors_speeds_[VESC_IDS::BACK_RIGHT] = wheel_speeds.rr;
       robotstatus_.linear_vel = velocities.linear_velocity;
       robotstatus_.angular_vel = velocities.angular_velocity;
+      robotstatus_.comm_round_trip_ms = latency.round_trip_ms;
+      robotstatus_.telemetry_age_ms = latency.telemetry_age_ms;
+      robotstatus_.thermal_derate_factor =
+          skid_control_->getThermalDerateFactor();
+      robotstatus_.thermal_time_to_limit =
+          skid_control_->getThermalTimeToLimit();
+      robotstatus_.acceleration_scale = skid_control_->getAccelerationScale();
       robotstatus_mutex_.unlock();
       if(comm_type_ == "SERIAL")
         send_motors_commands();
@@ -587,11 +757,19 @@ void DifferentialRobot::motors_control_loop(int sleeptime) {
       motors_speeds_[VESC_IDS::BACK_RIGHT] = MOTOR_NEUTRAL_;
       robotstatus_.linear_vel = velocities.linear_velocity;
       robotstatus_.angular_vel = velocities.angular_velocity;
+      robotstatus_.comm_round_trip_ms = latency.round_trip_ms;
+      robotstatus_.telemetry_age_ms = latency.telemetry_age_ms;
+      robotstatus_.thermal_derate_factor =
+          skid_control_->getThermalDerateFactor();
+      robotstatus_.thermal_time_to_limit =
+          skid_control_->getThermalTimeToLimit();
+      robotstatus_.acceleration_scale = skid_control_->getAccelerationScale();
       robotstatus_mutex_.unlock();
       if(comm_type_ == "SERIAL")
         send_motors_commands();
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleeptime));
+    if (!Utilities::RoverClock::sleep_for(std::chrono::milliseconds(sleeptime)))
+      return;
   }
 }
 
@@ -9,7 +9,12 @@ ProProtocolObject::ProProtocolObject(const char *device,
   comm_type_ = new_comm_type;
   robot_mode_ = robot_mode;
   robotstatus_ = {0};
+  /* no thermal derating or current-aware acceleration on this robot */
+  robotstatus_.thermal_derate_factor = 1;
+  robotstatus_.thermal_time_to_limit = std::numeric_limits<float>::infinity();
+  robotstatus_.acceleration_scale = 1;
   estop_ = false;
+  delay_compensation_ = false;
   motors_speeds_[LEFT_MOTOR] = MOTOR_NEUTRAL_;
   motors_speeds_[RIGHT_MOTOR] = MOTOR_NEUTRAL_;
   motors_speeds_[FLIPPER_MOTOR] = MOTOR_NEUTRAL_;
@@ -32,15 +37,35 @@ ProProtocolObject::ProProtocolObject(const char *device,
 
   register_comm_base(device);
 
+  running_ = true;
   // Create a New Thread with 30 mili seconds sleep timer
   fast_data_write_thread_ =
-      std::thread([this, fast_data]() { this->send_command(30, fast_data); });
+      std::thread([this, fast_data]() {
+        Utilities::set_thread_name("rover_wr_fast");
+        this->send_command(30, fast_data);
+      });
   // Create a new Thread with 50 mili seconds sleep timer
   slow_data_write_thread_ =
-      std::thread([this, slow_data]() { this->send_command(50, slow_data); });
+      std::thread([this, slow_data]() {
+        Utilities::set_thread_name("rover_wr_slow");
+        this->send_command(50, slow_data);
+      });
   // Create a motor update thread with 30 mili second sleep timer
   motor_commands_update_thread_ =
-      std::thread([this]() { this->motors_control_loop(30); });
+      std::thread([this]() {
+        Utilities::set_thread_name("rover_control");
+        this->motors_control_loop(30);
+      });
+}
+
+ProProtocolObject::~ProProtocolObject() {
+  running_ = false;
+  for (auto *thread : {&fast_data_write_thread_, &slow_data_write_thread_,
+                       &motor_commands_update_thread_}) {
+    if (thread->joinable()) thread->join();
+  }
+  // stop the reader before the status members it writes are destroyed
+  comm_base_.reset();
 }
 
 void ProProtocolObject::update_drivetrim(double value) { trimvalue_ += value; }
@@ -51,6 +76,54 @@ void ProProtocolObject::send_estop(bool estop) {
   robotstatus_mutex_.unlock();
 }
 
+void ProProtocolObject::set_delay_compensation(bool enable) {
+  robotstatus_mutex_.lock();
+  delay_compensation_ = enable;
+  motor1_delay_compensator_.reset();
+  motor2_delay_compensator_.reset();
+  robotstatus_mutex_.unlock();
+}
+
+Control::control_config ProProtocolObject::get_control_config() {
+  robotstatus_mutex_.lock();
+  auto pid = pid_;
+  robotstatus_mutex_.unlock();
+  /* everything but the gains is fixed on this robot */
+  return (Control::control_config){
+      .pid = pid,
+      .acceleration_limits = {std::numeric_limits<float>::max(),
+                              std::numeric_limits<float>::max()},
+      .angular_scaling = {.a_coef = 0,
+                          .b_coef = 0,
+                          .c_coef = 1,
+                          .min_scale_val = 1,
+                          .max_scale_val = 1},
+      .geometric_decay = 1,
+      .geometry = {.intra_axle_distance = 0,
+                   .wheel_base = (float)wheel2wheelDistance,
+                   .wheel_radius = (float)(MOTOR_DIST_PER_ROT_ / (2 * M_PI)),
+                   .center_of_mass_x_offset = 0,
+                   .center_of_mass_y_offset = 0},
+      .thermal = Control::defaultThermalDeratingParams(),
+      .current_limits = Control::defaultCurrentLimitParams()};
+}
+
+void ProProtocolObject::update_control_config(Control::control_config config) {
+  robotstatus_mutex_.lock();
+  pid_ = config.pid;
+  /* motors_control_loop holds the same lock, so this lands between cycles */
+  for (auto *control : {&motor1_control_, &motor2_control_}) {
+    control->K_P_ = pid_.kp;
+    control->K_I_ = pid_.ki;
+    control->K_D_ = pid_.kd;
+  }
+  robotstatus_mutex_.unlock();
+}
+
+unsigned int ProProtocolObject::supported_control_config() {
+  return Control::CONFIG_PID;
+}
+
 robotData ProProtocolObject::status_request() {
   return robotstatus_;
 }
@@ -64,7 +137,7 @@ void ProProtocolObject::set_robot_velocity(double *controlarray) {
   motors_speeds_[FLIPPER_MOTOR] =
       (int)round(controlarray[2] + MOTOR_NEUTRAL_) % MOTOR_MAX_;
   robotstatus_.cmd_ts = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::system_clock::now().time_since_epoch());
+      Utilities::RoverClock::now().time_since_epoch());
   robotstatus_mutex_.unlock();
 }
 
@@ -76,32 +149,47 @@ void ProProtocolObject::motors_control_loop(int sleeptime) {
 
   std::chrono::milliseconds time_last =
       std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::system_clock::now().time_since_epoch());
+          Utilities::RoverClock::now().time_since_epoch());
   std::chrono::milliseconds time_from_msg;
 
-  while (true) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleeptime));
+  while (running_) {
+    if (!Utilities::RoverClock::sleep_for(std::chrono::milliseconds(sleeptime)))
+      return;
     std::chrono::milliseconds time_now =
         std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch());
+            Utilities::RoverClock::now().time_since_epoch());
     robotstatus_mutex_.lock();
     int firmware = robotstatus_.robot_firmware;
     linear_vel = robotstatus_.cmd_linear_vel;
     angular_vel = robotstatus_.cmd_angular_vel;
     rpm1 = robotstatus_.motor1_rpm;
     rpm2 = robotstatus_.motor2_rpm;
+    unsigned int rpm1_sequence = robotstatus_.motor1_stamp.sequence;
+    unsigned int rpm2_sequence = robotstatus_.motor2_stamp.sequence;
     time_from_msg = robotstatus_.cmd_ts;
+    /* the pid would act on old wheel speeds once their registers stop
+     * arriving */
+    bool feedback_lost =
+        closed_loop_ &&
+        (is_lost(robotstatus_.motor1_stamp, time_now, TELEMETRY_TIMEOUT_) ||
+         is_lost(robotstatus_.motor2_stamp, time_now, TELEMETRY_TIMEOUT_));
+    auto latency = latency_.getStats();
+    robotstatus_.comm_round_trip_ms = latency.round_trip_ms;
+    robotstatus_.telemetry_age_ms = latency.telemetry_age_ms;
     robotstatus_mutex_.unlock();
     float ctrl_update_elapsedtime = (time_now - time_from_msg).count();
     float pid_update_elapsedtime = (time_now - time_last).count();
 
-    if (ctrl_update_elapsedtime > CONTROL_LOOP_TIMEOUT_MS_ || estop_) {
+    if (ctrl_update_elapsedtime > CONTROL_LOOP_TIMEOUT_MS_ || estop_ ||
+        feedback_lost) {
       robotstatus_mutex_.lock();
       motors_speeds_[LEFT_MOTOR] = MOTOR_NEUTRAL_;
       motors_speeds_[RIGHT_MOTOR] = MOTOR_NEUTRAL_;
       motors_speeds_[FLIPPER_MOTOR] = MOTOR_NEUTRAL_;
       motor1_control_.reset();
       motor2_control_.reset();
+      motor1_delay_compensator_.reset();
+      motor2_delay_compensator_.reset();
       robotstatus_mutex_.unlock();
       time_last = time_now;
       continue;
@@ -126,6 +214,16 @@ void ProProtocolObject::motors_control_loop(int sleeptime) {
     double motor1_measured_vel = rpm1 / MOTOR_RPM_TO_MPS_RATIO_;
     double motor2_measured_vel = rpm2 / MOTOR_RPM_TO_MPS_RATIO_;
     robotstatus_mutex_.lock();
+    if (delay_compensation_) {
+      // predict where the wheels are now rather than where they were
+      float measurement_delay = latency_.getMeasurementDelay();
+      motor1_measured_vel = motor1_delay_compensator_.predict(
+          motor1_measured_vel, rpm1_sequence, pid_update_elapsedtime / 1000,
+          measurement_delay);
+      motor2_measured_vel = motor2_delay_compensator_.predict(
+          motor2_measured_vel, rpm2_sequence, pid_update_elapsedtime / 1000,
+          measurement_delay);
+    }
     // motor speeds in m/s
     motors_speeds_[LEFT_MOTOR] =
         motor1_control_.run(motor1_vel, motor1_measured_vel,
@@ -134,14 +232,15 @@ void ProProtocolObject::motors_control_loop(int sleeptime) {
         motor2_control_.run(motor2_vel, motor2_measured_vel,
                             pid_update_elapsedtime / 1000, firmware);
 
-    // Convert to 8 bit Command
+    // Convert to the 8 bit command scale; kept fractional, send_command
+    // dithers it onto whole steps
     motors_speeds_[LEFT_MOTOR] = motor1_control_.boundMotorSpeed(
-        int(round(motors_speeds_[LEFT_MOTOR] * 50 + MOTOR_NEUTRAL_)),
-        MOTOR_MAX_, MOTOR_MIN_);
+        motors_speeds_[LEFT_MOTOR] * 50 + MOTOR_NEUTRAL_, MOTOR_MAX_,
+        MOTOR_MIN_);
 
     motors_speeds_[RIGHT_MOTOR] = motor2_control_.boundMotorSpeed(
-        int(round(motors_speeds_[RIGHT_MOTOR] * 50 + MOTOR_NEUTRAL_)),
-        MOTOR_MAX_, MOTOR_MIN_);
+        motors_speeds_[RIGHT_MOTOR] * 50 + MOTOR_NEUTRAL_, MOTOR_MAX_,
+        MOTOR_MIN_);
     robotstatus_mutex_.unlock();
     time_last = time_now;
   }
@@ -185,21 +284,28 @@ void ProProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
     checksum = 255 - (dataNO + data1 + data2) % 255;
     read_checksum = (unsigned char)msgqueue[4];
     if (checksum == read_checksum) {  // verify checksum
+      latency_.markReply();
+      auto received = std::chrono::duration_cast<std::chrono::milliseconds>(
+          Utilities::RoverClock::now().time_since_epoch());
       int16_t b = (data1 << 8) + data2;
       switch (int(dataNO)) {
         case REG_PWR_TOTAL_CURRENT:
           break;
         case REG_MOTOR_FB_RPM_LEFT:
           robotstatus_.motor1_rpm = b;
+          stamp_field(robotstatus_.motor1_stamp, received);
           break;
         case REG_MOTOR_FB_RPM_RIGHT:  // motor2_rpm;
           robotstatus_.motor2_rpm = b;
+          stamp_field(robotstatus_.motor2_stamp, received);
           break;
         case REG_FLIPPER_FB_POSITION_POT1:
           robotstatus_.motor3_sensor1 = b;
+          stamp_field(robotstatus_.flipper_stamp, received);
           break;
         case REG_FLIPPER_FB_POSITION_POT2:
           robotstatus_.motor3_sensor2 = b;
+          stamp_field(robotstatus_.flipper_stamp, received);
           break;
         case REG_MOTOR_FB_CURRENT_LEFT:
           robotstatus_.motor1_current = b;
@@ -213,16 +319,20 @@ void ProProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
           break;
         case REG_MOTOR_FAULT_FLAG_LEFT:
           robotstatus_.robot_fault_flag = b;
+          stamp_field(robotstatus_.robot_info_stamp, received);
           break;
         case REG_MOTOR_TEMP_LEFT:
           robotstatus_.motor1_temp = b;
+          stamp_field(robotstatus_.motor1_temp_stamp, received);
           break;
         case REG_MOTOR_TEMP_RIGHT:
           robotstatus_.motor2_temp = b;
+          stamp_field(robotstatus_.motor2_temp_stamp, received);
           break;
         case REG_PWR_BAT_VOLTAGE_A:
           if (robotstatus_.robot_firmware == 10009) {
             robotstatus_.battery1_SOC = b;
+            stamp_field(robotstatus_.battery1_stamp, received);
           }
           break;
         case REG_PWR_BAT_VOLTAGE_B:
@@ -236,6 +346,7 @@ void ProProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
         case REG_ROBOT_REL_SOC_A:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery1_SOC = b;
+            stamp_field(robotstatus_.battery1_stamp, received);
           }
           break;
         case REG_ROBOT_REL_SOC_B:
@@ -244,6 +355,7 @@ void ProProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
           break;
         case BuildNO:
           robotstatus_.robot_firmware = b;
+          stamp_field(robotstatus_.robot_info_stamp, received);
           break;
         case REG_PWR_A_CURRENT:
           break;
@@ -251,9 +363,11 @@ void ProProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
           break;
         case REG_MOTOR_FLIPPER_ANGLE:
           robotstatus_.motor3_angle = b;
+          stamp_field(robotstatus_.flipper_stamp, received);
           break;
         case to_computer_REG_MOTOR_SIDE_FAN_SPEED:
           robotstatus_.robot_fan_speed = b;
+          stamp_field(robotstatus_.robot_info_stamp, received);
           break;
         case to_computer_REG_MOTOR_SLOW_SPEED:
           break;
@@ -264,41 +378,49 @@ void ProProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
         case BATTERY_MODE_A:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery1_fault_flag = b;
+            stamp_field(robotstatus_.battery1_stamp, received);
           }
           break;
         case BATTERY_MODE_B:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery2_fault_flag = b;
+            stamp_field(robotstatus_.battery2_stamp, received);
           }
           break;
         case BATTERY_TEMP_A:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery1_temp = b;
+            stamp_field(robotstatus_.battery1_stamp, received);
           }
           break;
         case BATTERY_TEMP_B:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery2_temp = b;
+            stamp_field(robotstatus_.battery2_stamp, received);
           }
           break;
         case BATTERY_VOLTAGE_A:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery1_voltage = b;
+            stamp_field(robotstatus_.battery1_stamp, received);
           }
           break;
         case BATTERY_VOLTAGE_B:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery2_voltage = b;
+            stamp_field(robotstatus_.battery2_stamp, received);
           }
           break;
         case BATTERY_CURRENT_A:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery1_current = b;
+            stamp_field(robotstatus_.battery1_stamp, received);
           }
           break;
         case BATTERY_CURRENT_B:
           if (robotstatus_.robot_firmware != OVF_FIXED_FIRM_VER_) {
             robotstatus_.battery2_current = b;
+            stamp_field(robotstatus_.battery2_stamp, received);
           }
           break;
       }
@@ -397,32 +519,41 @@ void ProProtocolObject::register_comm_base(const char *device) {
 
 void ProProtocolObject::send_command(int sleeptime,
                                      std::vector<uint32_t> datalist) {
-  while (true) {
+  while (running_) {
     for (int x : datalist) {
       if (comm_type_ == "serial") {
         robotstatus_mutex_.lock();
+        // Every frame (from either request thread) carries the next dithered
+        // step, so the drive commands resolve below one step on average
+        if (motors_speeds_[LEFT_MOTOR] == MOTOR_NEUTRAL_)
+          motor1_quantizer_.reset();
+        if (motors_speeds_[RIGHT_MOTOR] == MOTOR_NEUTRAL_)
+          motor2_quantizer_.reset();
+        unsigned char left_command =
+            motor1_quantizer_.quantize(motors_speeds_[LEFT_MOTOR]);
+        unsigned char right_command =
+            motor2_quantizer_.quantize(motors_speeds_[RIGHT_MOTOR]);
+        unsigned char flipper_command =
+            (unsigned char)int(motors_speeds_[FLIPPER_MOTOR]);
         std::vector<unsigned char> write_buffer = {
-            (unsigned char)startbyte_,
-            (unsigned char)int(motors_speeds_[LEFT_MOTOR]),
-            (unsigned char)int(motors_speeds_[RIGHT_MOTOR]),
-            (unsigned char)int(motors_speeds_[FLIPPER_MOTOR]),
-            (unsigned char)requestbyte_,
-            (unsigned char)x};
+            (unsigned char)startbyte_, left_command, right_command,
+            flipper_command, (unsigned char)requestbyte_, (unsigned char)x};
 
         write_buffer.push_back(
-            (char)255 - ((unsigned char)int(motors_speeds_[LEFT_MOTOR]) +
-                         (unsigned char)int(motors_speeds_[RIGHT_MOTOR]) +
-                         (unsigned char)int(motors_speeds_[FLIPPER_MOTOR]) +
+            (char)255 - (left_command + right_command + flipper_command +
                          requestbyte_ + x) %
                             255);
         comm_base_->write_to_device(write_buffer);
+        latency_.markRequest();
         robotstatus_mutex_.unlock();
       } else if (comm_type_ == "can") {
         return;  //* no CAN for rover pro
       } else {   //! How did you get here?
         return;  // TODO: Return error ?
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(sleeptime));
+      if (!Utilities::RoverClock::sleep_for(
+              std::chrono::milliseconds(sleeptime)))
+        return;
     }
   }
 }
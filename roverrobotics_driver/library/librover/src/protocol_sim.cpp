@@ -0,0 +1,242 @@
+#include "protocol_sim.hpp"
+
+#include <cmath>
+
+namespace RoverRobotics {
+SimulatedProtocolObject::SimulatedProtocolObject(
+    Control::robot_motion_mode_t robot_mode, float wheel_radius,
+    float wheel_base, float robot_length, Control::pid_gains pid,
+    Control::angular_scaling_params angular_scale) {
+  /* clear main data structure for holding robot status and commands */
+  robotstatus_ = {0};
+  robotstatus_.battery1_voltage = BATTERY_VOLTAGE_;
+  robotstatus_.battery1_SOC = 100;
+
+  angular_scaling_params_ = angular_scale;
+
+  robot_geometry_ = {.intra_axle_distance = robot_length,
+                     .wheel_base = wheel_base,
+                     .wheel_radius = wheel_radius,
+                     .center_of_mass_x_offset = 0,
+                     .center_of_mass_y_offset = 0};
+
+  /* clear estop and zero out all motors */
+  estop_ = false;
+  motors_speeds_ = {0, 0, 0, 0};
+  wheel_rpms_ = {0, 0, 0, 0};
+
+  robot_mode_ = robot_mode;
+  pid_ = pid;
+
+  /* the same motion logic as the real skid steer robots */
+  skid_control_ = std::make_unique<Control::SkidRobotMotionController>(
+      robot_mode_, robot_geometry_, pid_, MOTOR_MAX_, MOTOR_MIN_, left_trim_,
+      right_trim_, geometric_decay_);
+  skid_control_->setOperatingMode(robot_mode_);
+  skid_control_->setAccelerationLimits({LINEAR_JERK_LIMIT_, 30.0});
+  skid_control_->setAngularScaling(angular_scaling_params_);
+
+  running_ = true;
+  simulation_thread_ = std::thread([this]() {
+    Utilities::set_thread_name("rover_sim");
+    this->simulation_loop(5);
+  });
+  motor_speed_update_thread_ =
+      std::thread([this]() {
+        Utilities::set_thread_name("rover_control");
+        this->motors_control_loop(30);
+      });
+}
+
+SimulatedProtocolObject::~SimulatedProtocolObject() {
+  running_ = false;
+  if (motor_speed_update_thread_.joinable()) motor_speed_update_thread_.join();
+  if (simulation_thread_.joinable()) simulation_thread_.join();
+}
+
+void SimulatedProtocolObject::send_estop(bool estop) {
+  robotstatus_mutex_.lock();
+  estop_ = estop;
+  robotstatus_mutex_.unlock();
+}
+
+void SimulatedProtocolObject::set_delay_compensation(bool enable) {
+  skid_control_->setDelayCompensation(enable);
+}
+
+Control::control_config SimulatedProtocolObject::get_control_config() {
+  return skid_control_->getControlConfig();
+}
+
+void SimulatedProtocolObject::update_control_config(
+    Control::control_config config) {
+  skid_control_->setControlConfig(config);
+}
+
+unsigned int SimulatedProtocolObject::supported_control_config() {
+  return Control::CONFIG_ALL;
+}
+
+robotData SimulatedProtocolObject::status_request() {
+  robotstatus_mutex_.lock();
+  auto returnData = robotstatus_;
+  robotstatus_mutex_.unlock();
+  return returnData;
+}
+
+robotData SimulatedProtocolObject::info_request() { return status_request(); }
+
+int SimulatedProtocolObject::cycle_robot_mode() { return -1; }
+
+void SimulatedProtocolObject::set_robot_velocity(double *control_array) {
+  robotstatus_mutex_.lock();
+  robotstatus_.cmd_linear_vel = control_array[0];
+  robotstatus_.cmd_angular_vel = control_array[1];
+  robotstatus_.cmd_ts = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Utilities::RoverClock::now().time_since_epoch());
+  robotstatus_mutex_.unlock();
+}
+
+void SimulatedProtocolObject::unpack_comm_response(std::vector<uint8_t>) {}
+
+bool SimulatedProtocolObject::is_connected() { return true; }
+
+void SimulatedProtocolObject::register_comm_base(const char *) {}
+
+void SimulatedProtocolObject::update_drivetrim(double delta) {
+  if (-MAX_CURVATURE_CORRECTION_ < (trimvalue_ + delta) &&
+      (trimvalue_ + delta) < MAX_CURVATURE_CORRECTION_) {
+    trimvalue_ += delta;
+
+    /* reduce power to right wheels */
+    if (trimvalue_ >= 0) {
+      left_trim_ = 1;
+      right_trim_ = 1 - trimvalue_;
+    }
+    /* reduce power to left wheels */
+    else {
+      right_trim_ = 1;
+      left_trim_ = 1 + trimvalue_;
+    }
+    skid_control_->setTrim(left_trim_, right_trim_);
+  }
+}
+
+void SimulatedProtocolObject::motors_control_loop(int sleeptime) {
+  float linear_vel_target, angular_vel_target;
+  Control::motor_data rpms;
+  std::chrono::milliseconds time_from_msg;
+  Control::drive_telemetry drive_telemetry = {0};
+  drive_telemetry.motor_temperatures = {NAN, NAN, NAN, NAN};
+  drive_telemetry.mosfet_temperatures = {NAN, NAN, NAN, NAN};
+
+  while (running_) {
+    std::chrono::milliseconds time_now =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            Utilities::RoverClock::now().time_since_epoch());
+
+    /* collect user commands and various status */
+    robotstatus_mutex_.lock();
+    linear_vel_target = robotstatus_.cmd_linear_vel;
+    angular_vel_target = robotstatus_.cmd_angular_vel;
+    rpms = wheel_rpms_;
+    skid_control_->setWheelSpeedSequences(
+        {robotstatus_.motor1_stamp.sequence, robotstatus_.motor2_stamp.sequence,
+         robotstatus_.motor3_stamp.sequence,
+         robotstatus_.motor4_stamp.sequence});
+    time_from_msg = robotstatus_.cmd_ts;
+    drive_telemetry.battery_voltage = robotstatus_.battery1_voltage;
+    drive_telemetry.battery_current = robotstatus_.battery1_current;
+    drive_telemetry.motor_currents = {
+        robotstatus_.motor1_current, robotstatus_.motor2_current,
+        robotstatus_.motor3_current, robotstatus_.motor4_current};
+    bool estop = estop_;
+    robotstatus_mutex_.unlock();
+    skid_control_->setDriveTelemetry(drive_telemetry);
+
+    /* compute motion targets if no estop and data is not stale */
+    bool command_valid =
+        !estop &&
+        (time_now - time_from_msg).count() <= CONTROL_LOOP_TIMEOUT_MS_;
+    auto duty_cycles = skid_control_->runMotionControl(
+        command_valid
+            ? (Control::robot_velocities){.linear_velocity = linear_vel_target,
+                                          .angular_velocity =
+                                              angular_vel_target}
+            : (Control::robot_velocities){0, 0},
+        (Control::motor_data){.fl = 0, .fr = 0, .rl = 0, .rr = 0}, rpms);
+    auto velocities = skid_control_->getMeasuredVelocities(rpms);
+
+    /* update the main data structure with both commands and status */
+    robotstatus_mutex_.lock();
+    if (command_valid) {
+      motors_speeds_ = duty_cycles;
+    } else {
+      motors_speeds_ = {MOTOR_NEUTRAL_, MOTOR_NEUTRAL_, MOTOR_NEUTRAL_,
+                        MOTOR_NEUTRAL_};
+    }
+    robotstatus_.linear_vel = velocities.linear_velocity;
+    robotstatus_.angular_vel = velocities.angular_velocity;
+    robotstatus_.thermal_derate_factor =
+        skid_control_->getThermalDerateFactor();
+    robotstatus_.thermal_time_to_limit = skid_control_->getThermalTimeToLimit();
+    robotstatus_.acceleration_scale = skid_control_->getAccelerationScale();
+    robotstatus_mutex_.unlock();
+
+    if (!Utilities::RoverClock::sleep_for(std::chrono::milliseconds(sleeptime)))
+      return;
+  }
+}
+
+void SimulatedProtocolObject::simulation_loop(int sleeptime) {
+  auto time_last = Utilities::RoverClock::now();
+
+  while (running_) {
+    if (!Utilities::RoverClock::sleep_for(std::chrono::milliseconds(sleeptime)))
+      return;
+    auto time_now = Utilities::RoverClock::now();
+    float delta_time =
+        std::chrono::duration<float>(time_now - time_last).count();
+    time_last = time_now;
+    if (delta_time <= 0) continue;
+
+    /* first order lag of each wheel towards the speed its duty cycle and the
+     * battery voltage can sustain; current is driven by the back-emf deficit */
+    float alpha = 1 - std::exp(-delta_time / MOTOR_TIME_CONSTANT_);
+    robotstatus_mutex_.lock();
+    float voltage_ratio = robotstatus_.battery1_voltage / BATTERY_VOLTAGE_;
+    float duty[4] = {motors_speeds_.fl, motors_speeds_.fr, motors_speeds_.rl,
+                     motors_speeds_.rr};
+    float *rpm[4] = {&wheel_rpms_.fl, &wheel_rpms_.fr, &wheel_rpms_.rl,
+                     &wheel_rpms_.rr};
+    float current[4];
+    float battery_current = 0;
+    for (int i = 0; i < 4; i++) {
+      *rpm[i] += alpha * (duty[i] * voltage_ratio * OPEN_LOOP_MAX_RPM_ - *rpm[i]);
+      current[i] = MOTOR_STALL_CURRENT_ *
+                   (duty[i] * voltage_ratio - *rpm[i] / OPEN_LOOP_MAX_RPM_);
+      battery_current += std::max(0.0f, duty[i] * current[i]);
+    }
+    robotstatus_.motor1_rpm = wheel_rpms_.fl;
+    robotstatus_.motor2_rpm = wheel_rpms_.fr;
+    robotstatus_.motor3_rpm = wheel_rpms_.rl;
+    robotstatus_.motor4_rpm = wheel_rpms_.rr;
+    robotstatus_.motor1_current = current[0];
+    robotstatus_.motor2_current = current[1];
+    robotstatus_.motor3_current = current[2];
+    robotstatus_.motor4_current = current[3];
+    robotstatus_.battery1_current = battery_current;
+    robotstatus_.battery1_voltage =
+        BATTERY_VOLTAGE_ - BATTERY_RESISTANCE_ * battery_current;
+    auto sampled = std::chrono::duration_cast<std::chrono::milliseconds>(
+        time_now.time_since_epoch());
+    stamp_field(robotstatus_.motor1_stamp, sampled);
+    stamp_field(robotstatus_.motor2_stamp, sampled);
+    stamp_field(robotstatus_.motor3_stamp, sampled);
+    stamp_field(robotstatus_.motor4_stamp, sampled);
+    stamp_field(robotstatus_.battery1_stamp, sampled);
+    robotstatus_mutex_.unlock();
+  }
+}
+
+}  // namespace RoverRobotics
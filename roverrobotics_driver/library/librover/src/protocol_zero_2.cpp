@@ -74,17 +74,33 @@ Zero2ProtocolObject::Zero2ProtocolObject(
   /* create a dedicated write thread to send commands to the robot on fixed
    * interval */
  /* std::cerr << "creating thread to communicate with rover zero..." << std::endl; */
+  running_ = true;
   write_to_robot_thread_ =
   
-      std::thread([this]() { this->send_getvalues_command(10); });
+      std::thread([this]() {
+        Utilities::set_thread_name("rover_write");
+        this->send_getvalues_command(10);
+      });
     
   /* create a dedicate thread to compute the desired robot motion, runs on fixed
    * interval */
   motor_speed_update_thread_ =
-      std::thread([this]() { this->motors_control_loop(30); });
+      std::thread([this]() {
+        Utilities::set_thread_name("rover_control");
+        this->motors_control_loop(30);
+      });
   std::cerr << "protocol is running..." << std::endl;
 }
 
+Zero2ProtocolObject::~Zero2ProtocolObject() {
+  running_ = false;
+  if (write_to_robot_thread_.joinable()) write_to_robot_thread_.join();
+  if (slow_data_write_thread_.joinable()) slow_data_write_thread_.join();
+  if (motor_speed_update_thread_.joinable()) motor_speed_update_thread_.join();
+  // stop the reader before the status members it writes are destroyed
+  comm_base_.reset();
+}
+
 void Zero2ProtocolObject::load_persistent_params() {
   /* trim (aka curvature correction) */
   if (auto param = persistent_params_->read_param("trim")) {
@@ -121,6 +137,22 @@ void Zero2ProtocolObject::send_estop(bool estop) {
   robotstatus_mutex_.unlock();
 }
 
+void Zero2ProtocolObject::set_delay_compensation(bool enable) {
+  skid_control_->setDelayCompensation(enable);
+}
+
+Control::control_config Zero2ProtocolObject::get_control_config() {
+  return skid_control_->getControlConfig();
+}
+
+void Zero2ProtocolObject::update_control_config(Control::control_config config) {
+  skid_control_->setControlConfig(config);
+}
+
+unsigned int Zero2ProtocolObject::supported_control_config() {
+  return Control::CONFIG_ALL;
+}
+
 robotData Zero2ProtocolObject::status_request() { return robotstatus_; }
 
 robotData Zero2ProtocolObject::info_request() { return robotstatus_; }
@@ -130,7 +162,7 @@ void Zero2ProtocolObject::set_robot_velocity(double *controlarray) {
   robotstatus_.cmd_linear_vel = controlarray[0];
   robotstatus_.cmd_angular_vel = controlarray[1];
   robotstatus_.cmd_ts = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::system_clock::now().time_since_epoch());
+      Utilities::RoverClock::now().time_since_epoch());
   robotstatus_mutex_.unlock();
 }
 
@@ -138,13 +170,14 @@ void Zero2ProtocolObject::motors_control_loop(int sleeptime) {
   float linear_vel_target, angular_vel_target, rpm_FL, rpm_FR, rpm_BL, rpm_BR;
   std::chrono::milliseconds time_last =
       std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::system_clock::now().time_since_epoch());
+          Utilities::RoverClock::now().time_since_epoch());
   std::chrono::milliseconds time_from_msg;
+  Control::drive_telemetry drive_telemetry = {0};
 
-  while (true) {
+  while (running_) {
     std::chrono::milliseconds time_now =
         std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch());
+            Utilities::RoverClock::now().time_since_epoch());
 
     /* collect user commands and various status */
     robotstatus_mutex_.lock();
@@ -156,11 +189,56 @@ void Zero2ProtocolObject::motors_control_loop(int sleeptime) {
     rpm_FR = robotstatus_.motor2_rpm / MOTOR_RPM_TO_WHEEL_RPM_RATIO_;
     rpm_BL = robotstatus_.motor1_rpm / MOTOR_RPM_TO_WHEEL_RPM_RATIO_;
     rpm_BR = robotstatus_.motor2_rpm / MOTOR_RPM_TO_WHEEL_RPM_RATIO_;
+    skid_control_->setWheelSpeedSequences(
+        {robotstatus_.motor1_stamp.sequence, robotstatus_.motor2_stamp.sequence,
+         robotstatus_.motor1_stamp.sequence,
+         robotstatus_.motor2_stamp.sequence});
     time_from_msg = robotstatus_.cmd_ts;
+    /* telemetry that stopped arriving is unknown rather than its last value */
+    bool left_lost =
+        is_lost(robotstatus_.motor1_stamp, time_now, TELEMETRY_TIMEOUT_);
+    bool right_lost =
+        is_lost(robotstatus_.motor2_stamp, time_now, TELEMETRY_TIMEOUT_);
+    bool battery_lost =
+        is_lost(robotstatus_.battery1_stamp, time_now, TELEMETRY_TIMEOUT_);
+    float left_current = left_lost ? NAN : robotstatus_.motor1_current;
+    float right_current = right_lost ? NAN : robotstatus_.motor2_current;
+    /* temperatures that were never reported or went stale are unknown */
+    bool left_temp_stale =
+        is_stale(robotstatus_.motor1_temp_stamp, time_now, TELEMETRY_TIMEOUT_);
+    bool right_temp_stale =
+        is_stale(robotstatus_.motor2_temp_stamp, time_now, TELEMETRY_TIMEOUT_);
+    float left_temp = left_temp_stale ? NAN : robotstatus_.motor1_temp;
+    float right_temp = right_temp_stale ? NAN : robotstatus_.motor2_temp;
+    float left_mos_temp = left_temp_stale ? NAN : robotstatus_.motor1_mos_temp;
+    float right_mos_temp =
+        right_temp_stale ? NAN : robotstatus_.motor2_mos_temp;
+    drive_telemetry.battery_voltage =
+        battery_lost ? 0 : robotstatus_.battery1_voltage;
+    drive_telemetry.battery_current =
+        battery_lost ? NAN : robotstatus_.battery1_current;
+    /* one motor per side, mirror it onto the rear wheels like the rpms */
+    drive_telemetry.motor_currents = {left_current, right_current,
+                                      left_current, right_current};
+    drive_telemetry.motor_temperatures = {left_temp, right_temp, left_temp,
+                                          right_temp};
+    drive_telemetry.mosfet_temperatures = {left_mos_temp, right_mos_temp,
+                                           left_mos_temp, right_mos_temp};
     robotstatus_mutex_.unlock();
+    bool feedback_lost = (left_lost || right_lost) &&
+                         skid_control_->getOperatingMode() != Control::OPEN_LOOP;
+    skid_control_->setDriveTelemetry(drive_telemetry);
 
-    /* compute motion targets if no estop and data is not stale */
-    if (!estop_ &&
+    /* the wheelspeeds are as old as the slowest motor controller's telemetry */
+    auto left_stats = left_latency_.getStats();
+    auto right_stats = right_latency_.getStats();
+    skid_control_->setMeasurementDelay(
+        std::max(left_latency_.getMeasurementDelay(),
+                 right_latency_.getMeasurementDelay()));
+
+    /* compute motion targets if no estop and data is not stale; without wheel
+     * feedback the closed loop would act on old speeds, so stop instead */
+    if (!estop_ && !feedback_lost &&
         (time_now - time_from_msg).count() <= CONTROL_LOOP_TIMEOUT_MS_) {
       /* compute motion targets (not using duty cycle input ATM) */
       auto duty_cycles = skid_control_->runMotionControl(
@@ -181,6 +259,15 @@ void Zero2ProtocolObject::motors_control_loop(int sleeptime) {
       motors_speeds_[RIGHT_MOTOR] = duty_cycles.fr;
       robotstatus_.linear_vel = velocities.linear_velocity;
       robotstatus_.angular_vel = velocities.angular_velocity;
+      robotstatus_.comm_round_trip_ms =
+          std::max(left_stats.round_trip_ms, right_stats.round_trip_ms);
+      robotstatus_.telemetry_age_ms =
+          std::max(left_stats.telemetry_age_ms, right_stats.telemetry_age_ms);
+      robotstatus_.thermal_derate_factor =
+          skid_control_->getThermalDerateFactor();
+      robotstatus_.thermal_time_to_limit =
+          skid_control_->getThermalTimeToLimit();
+      robotstatus_.acceleration_scale = skid_control_->getAccelerationScale();
       robotstatus_mutex_.unlock();
       send_motors_commands();
     } else {
@@ -196,10 +283,20 @@ void Zero2ProtocolObject::motors_control_loop(int sleeptime) {
       motors_speeds_[RIGHT_MOTOR] = MOTOR_NEUTRAL_;
       robotstatus_.linear_vel = velocities.linear_velocity;
       robotstatus_.angular_vel = velocities.angular_velocity;
+      robotstatus_.comm_round_trip_ms =
+          std::max(left_stats.round_trip_ms, right_stats.round_trip_ms);
+      robotstatus_.telemetry_age_ms =
+          std::max(left_stats.telemetry_age_ms, right_stats.telemetry_age_ms);
+      robotstatus_.thermal_derate_factor =
+          skid_control_->getThermalDerateFactor();
+      robotstatus_.thermal_time_to_limit =
+          skid_control_->getThermalTimeToLimit();
+      robotstatus_.acceleration_scale = skid_control_->getAccelerationScale();
       robotstatus_mutex_.unlock();
       send_motors_commands();
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleeptime));
+    if (!Utilities::RoverClock::sleep_for(std::chrono::milliseconds(sleeptime)))
+      return;
   }
 }
 void Zero2ProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
@@ -332,18 +429,26 @@ void Zero2ProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
     std::cerr << std::flush;
     msgqueue.clear();
     // msgqueue.resize(0);
+    auto received = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Utilities::RoverClock::now().time_since_epoch());
     if (vesc_dev_id_ == LEFT_MOTOR) {
+      left_latency_.markReply();
       robotstatus_.motor1_id = vesc_dev_id_;
       robotstatus_.motor1_current = vesc_all_input_current_;
       robotstatus_.motor1_rpm = vesc_rpm_;
       robotstatus_.motor1_temp = vesc_motor_temp_;
       robotstatus_.motor1_mos_temp = vesc_fet_temp_;
+      stamp_field(robotstatus_.motor1_stamp, received);
+      stamp_field(robotstatus_.motor1_temp_stamp, received);
     } else if (vesc_dev_id_ == RIGHT_MOTOR) {
+      right_latency_.markReply();
       robotstatus_.motor2_id = vesc_dev_id_;
       robotstatus_.motor2_current = vesc_all_input_current_;
       robotstatus_.motor2_rpm = vesc_rpm_;
       robotstatus_.motor2_temp = vesc_motor_temp_;
       robotstatus_.motor2_mos_temp = vesc_fet_temp_;
+      stamp_field(robotstatus_.motor2_stamp, received);
+      stamp_field(robotstatus_.motor2_temp_stamp, received);
     }
     robotstatus_.battery1_voltage = vesc_v_in_;
     robotstatus_.battery1_fault_flag = 0;
@@ -377,6 +482,8 @@ void Zero2ProtocolObject::unpack_comm_response(std::vector<uint8_t> robotmsg) {
     robotstatus_.robot_fault_flag = vesc_fault_;
     robotstatus_.robot_fan_speed = 0;
     robotstatus_.robot_speed_limit = 0;
+    stamp_field(robotstatus_.battery1_stamp, received);
+    stamp_field(robotstatus_.robot_info_stamp, received);
   } else if (msgqueue.size() > msg_size && msgqueue[0] != START_BYTE_) {
     int start_byte_index = 0;
     // !Did not find valid start byte in buffer
@@ -444,7 +551,7 @@ void Zero2ProtocolObject::register_comm_base(const char *device) {
 }
 
 void Zero2ProtocolObject::send_getvalues_command(int sleeptime) {
-  while (true) {
+  while (running_) {
     if (comm_type_ == "serial") {
       unsigned char *payloadptr;
       uint16_t crc;
@@ -460,6 +567,7 @@ void Zero2ProtocolObject::send_getvalues_command(int sleeptime) {
       write_buffer.push_back(static_cast<uint8_t>(crc & 0xFF));
       write_buffer.push_back(STOP_BYTE_);
       comm_base_->write_to_device(write_buffer);
+      left_latency_.markRequest();
       robotstatus_mutex_.unlock();
 
       robotstatus_mutex_.lock();
@@ -477,13 +585,15 @@ void Zero2ProtocolObject::send_getvalues_command(int sleeptime) {
       write_buffer.push_back(static_cast<uint8_t>(crc & 0xFF));
       write_buffer.push_back(STOP_BYTE_);
       comm_base_->write_to_device(write_buffer);
+      right_latency_.markRequest();
       robotstatus_mutex_.unlock();
     } else if (comm_type_ == "can") {
       return;
     } else {   //! How did you get here?
       return;  // TODO: Return error ?
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleeptime));
+    if (!Utilities::RoverClock::sleep_for(std::chrono::milliseconds(sleeptime)))
+      return;
   }
 }
 
@@ -0,0 +1,109 @@
+#include "rover_telemetry.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+namespace {
+const uint32_t MAGIC = 0x524f5652;  // "ROVR"
+const int READ_ATTEMPTS = 64;
+
+/* the sequence is odd while a snapshot is being written */
+struct segment {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t snapshot_size;
+  uint32_t reserved;
+  std::atomic<uint64_t> sequence;
+  rover_telemetry_snapshot snapshot;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the sequence is shared between processes");
+}  // namespace
+
+struct rover_telemetry {
+  segment *shm;
+  std::string name;
+  bool owner;
+};
+
+extern "C" {
+
+rover_telemetry *rover_telemetry_open(const char *name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return nullptr;
+  void *memory = mmap(nullptr, sizeof(segment), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) return nullptr;
+
+  auto shm = static_cast<segment *>(memory);
+  if (shm->magic != MAGIC || shm->version != ROVER_TELEMETRY_VERSION ||
+      shm->snapshot_size != sizeof(rover_telemetry_snapshot)) {
+    munmap(memory, sizeof(segment));
+    return nullptr;
+  }
+  return new rover_telemetry{shm, name, false};
+}
+
+int rover_telemetry_read(rover_telemetry *telemetry,
+                         rover_telemetry_snapshot *snapshot) {
+  segment *shm = telemetry->shm;
+  for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+    uint64_t before = shm->sequence.load(std::memory_order_acquire);
+    if (before == 0) return -1;
+    if (before & 1) continue;
+    std::memcpy(snapshot, &shm->snapshot, sizeof(*snapshot));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (shm->sequence.load(std::memory_order_relaxed) == before) return 0;
+  }
+  return -1;
+}
+
+void rover_telemetry_close(rover_telemetry *telemetry) {
+  if (!telemetry) return;
+  munmap(telemetry->shm, sizeof(segment));
+  if (telemetry->owner) shm_unlink(telemetry->name.c_str());
+  delete telemetry;
+}
+
+rover_telemetry *rover_telemetry_create(const char *name) {
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) return nullptr;
+  if (ftruncate(fd, sizeof(segment)) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  void *memory = mmap(nullptr, sizeof(segment), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) return nullptr;
+
+  /* readers reject the segment until the header is complete */
+  auto shm = static_cast<segment *>(memory);
+  shm->magic = 0;
+  shm->sequence.store(0, std::memory_order_relaxed);
+  shm->version = ROVER_TELEMETRY_VERSION;
+  shm->snapshot_size = sizeof(rover_telemetry_snapshot);
+  std::atomic_thread_fence(std::memory_order_release);
+  shm->magic = MAGIC;
+  return new rover_telemetry{shm, name, true};
+}
+
+void rover_telemetry_write(rover_telemetry *telemetry,
+                           const rover_telemetry_snapshot *snapshot) {
+  segment *shm = telemetry->shm;
+  uint64_t sequence = shm->sequence.load(std::memory_order_relaxed);
+  shm->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&shm->snapshot, snapshot, sizeof(*snapshot));
+  shm->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void rover_telemetry_destroy(rover_telemetry *telemetry) {
+  rover_telemetry_close(telemetry);
+}
+}
@@ -0,0 +1,104 @@
+#include "telemetry_exporter.hpp"
+
+#include <limits>
+
+namespace RoverRobotics {
+TelemetryExporter::TelemetryExporter(BaseProtocolObject *robot,
+                                     const std::string &name, float frequency)
+    : robot_(robot), running_(true) {
+  if (!(frequency > 0)) throw(INVALID_FREQUENCY_ERROR);
+  segment_ = rover_telemetry_create(name.c_str());
+  if (!segment_) throw(SHM_CREATION_ERROR);
+
+  auto period = std::chrono::nanoseconds(int64_t(1e9 / frequency));
+  export_thread_ = std::thread([this, period]() {
+    Utilities::set_thread_name("rover_telemetry");
+    this->export_loop_(period);
+  });
+}
+
+TelemetryExporter::~TelemetryExporter() {
+  running_ = false;
+  if (export_thread_.joinable()) export_thread_.join();
+  rover_telemetry_destroy(segment_);
+}
+
+void TelemetryExporter::export_loop_(std::chrono::nanoseconds period) {
+  auto next = Utilities::RoverClock::now();
+  while (running_) {
+    auto snapshot = make_snapshot_(robot_->status_request());
+    rover_telemetry_write(segment_, &snapshot);
+
+    /* fixed rate; after a stall, resume from now rather than catching up */
+    next += period;
+    auto now = Utilities::RoverClock::now();
+    if (next < now) next = now;
+    if (!Utilities::RoverClock::sleep_until(next)) return;
+  }
+}
+
+rover_telemetry_snapshot TelemetryExporter::make_snapshot_(
+    const robotData &data) {
+  auto now = Utilities::RoverClock::now();
+  auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now.time_since_epoch());
+  auto age = [&now_ms](const field_stamp &stamp) {
+    return stamp.sequence == 0 ? std::numeric_limits<float>::infinity()
+                               : float((now_ms - stamp.time).count());
+  };
+
+  rover_telemetry_snapshot snapshot = {};
+  snapshot.sequence = ++sequence_;
+  snapshot.stamp_ns = now.time_since_epoch().count();
+
+  snapshot.motor_rpm[0] = data.motor1_rpm;
+  snapshot.motor_rpm[1] = data.motor2_rpm;
+  snapshot.motor_rpm[2] = data.motor3_rpm;
+  snapshot.motor_rpm[3] = data.motor4_rpm;
+  snapshot.motor_current[0] = data.motor1_current;
+  snapshot.motor_current[1] = data.motor2_current;
+  snapshot.motor_current[2] = data.motor3_current;
+  snapshot.motor_current[3] = data.motor4_current;
+  snapshot.motor_temp[0] = data.motor1_temp;
+  snapshot.motor_temp[1] = data.motor2_temp;
+  snapshot.motor_temp[2] = data.motor3_temp;
+  snapshot.motor_temp[3] = data.motor4_temp;
+  snapshot.motor_mos_temp[0] = data.motor1_mos_temp;
+  snapshot.motor_mos_temp[1] = data.motor2_mos_temp;
+  snapshot.motor_mos_temp[2] = data.motor3_mos_temp;
+  snapshot.motor_mos_temp[3] = data.motor4_mos_temp;
+  snapshot.motor_age_ms[0] = age(data.motor1_stamp);
+  snapshot.motor_age_ms[1] = age(data.motor2_stamp);
+  snapshot.motor_age_ms[2] = age(data.motor3_stamp);
+  snapshot.motor_age_ms[3] = age(data.motor4_stamp);
+
+  snapshot.battery_voltage[0] = data.battery1_voltage;
+  snapshot.battery_voltage[1] = data.battery2_voltage;
+  snapshot.battery_current[0] = data.battery1_current;
+  snapshot.battery_current[1] = data.battery2_current;
+  snapshot.battery_soc[0] = data.battery1_SOC;
+  snapshot.battery_soc[1] = data.battery2_SOC;
+  snapshot.battery_temp[0] = data.battery1_temp;
+  snapshot.battery_temp[1] = data.battery2_temp;
+  snapshot.battery_fault_flag[0] = data.battery1_fault_flag;
+  snapshot.battery_fault_flag[1] = data.battery2_fault_flag;
+  snapshot.battery_age_ms[0] = age(data.battery1_stamp);
+  snapshot.battery_age_ms[1] = age(data.battery2_stamp);
+
+  snapshot.robot_firmware = data.robot_firmware;
+  snapshot.robot_fault_flag = data.robot_fault_flag;
+
+  snapshot.linear_vel = data.linear_vel;
+  snapshot.angular_vel = data.angular_vel;
+  snapshot.cmd_linear_vel = data.cmd_linear_vel;
+  snapshot.cmd_angular_vel = data.cmd_angular_vel;
+
+  snapshot.comm_round_trip_ms = data.comm_round_trip_ms;
+  snapshot.telemetry_age_ms = data.telemetry_age_ms;
+  snapshot.thermal_derate_factor = data.thermal_derate_factor;
+  snapshot.thermal_time_to_limit = data.thermal_time_to_limit;
+  snapshot.acceleration_scale = data.acceleration_scale;
+  return snapshot;
+}
+
+}  // namespace RoverRobotics
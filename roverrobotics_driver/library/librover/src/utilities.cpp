@@ -1,5 +1,11 @@
 #include "utilities.hpp"
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <sstream>
+#include <thread>
 namespace Utilities {
 
 PersistentParams::PersistentParams(std::string robot_param_path) {
@@ -111,4 +117,143 @@ std::vector<std::string> PersistentParams::split_(std::string str, std::string t
   return result;
 }
 
+
+std::shared_ptr<const RoverClock::time_source> RoverClock::source_;
+
+RoverClock::time_point RoverClock::now() {
+  if (auto source = std::atomic_load(&source_)) {
+    return time_point(duration(source->now()));
+  }
+  return time_point(std::chrono::duration_cast<duration>(
+      std::chrono::steady_clock::now().time_since_epoch()));
+}
+
+bool RoverClock::sleep_until(time_point time) {
+  if (auto source = std::atomic_load(&source_)) {
+    return source->sleep_until(time.time_since_epoch().count());
+  }
+  auto remaining = time - now();
+  if (remaining > duration::zero()) std::this_thread::sleep_for(remaining);
+  return true;
+}
+
+bool RoverClock::sleep_for(duration sleeptime) {
+  return sleep_until(now() + sleeptime);
+}
+
+void RoverClock::set_time_source(time_source source) {
+  std::atomic_store(&source_, std::shared_ptr<const time_source>(
+                                  std::make_shared<time_source>(source)));
+}
+
+void RoverClock::reset_time_source() {
+  std::atomic_store(&source_, std::shared_ptr<const time_source>());
+}
+
+void set_thread_name(const std::string &name) {
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+ThreadMonitor::ThreadMonitor()
+    : last_sample_(std::chrono::steady_clock::now()),
+      clock_ticks_(sysconf(_SC_CLK_TCK)) {}
+
+std::optional<thread_stats> ThreadMonitor::read_thread_(int tid,
+                                                       counters_ &counters) {
+  std::string task = "/proc/self/task/" + std::to_string(tid);
+  thread_stats stats = {};
+  stats.tid = tid;
+
+  std::ifstream comm(task + "/comm");
+  if (!std::getline(comm, stats.name)) return std::nullopt;
+
+  /* fields after the parenthesised name; utime and stime are 14 and 15 */
+  std::ifstream stat_file(task + "/stat");
+  std::string stat;
+  if (!std::getline(stat_file, stat)) return std::nullopt;
+  std::istringstream fields(stat.substr(stat.rfind(')') + 2));
+  std::string field;
+  unsigned long long utime = 0, stime = 0;
+  for (int n = 3; fields >> field && n <= 15; n++) {
+    if (n == 14) utime = std::stoull(field);
+    if (n == 15) stime = std::stoull(field);
+  }
+  stats.cpu_time = double(utime + stime) / clock_ticks_;
+
+  std::ifstream status(task + "/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("voluntary_ctxt_switches:", 0) == 0)
+      stats.voluntary_switches = std::stoull(line.substr(24));
+    else if (line.rfind("nonvoluntary_ctxt_switches:", 0) == 0)
+      stats.involuntary_switches = std::stoull(line.substr(27));
+  }
+
+  /* ns on cpu, ns waiting on a runqueue, timeslices; finer than stat */
+  counters.run_delay = 0;
+  std::ifstream schedstat(task + "/schedstat");
+  unsigned long long run_ns, wait_ns, slices;
+  if (schedstat >> run_ns >> wait_ns >> slices) {
+    stats.cpu_time = run_ns * 1e-9;
+    counters.run_delay = wait_ns * 1e-9;
+  }
+
+  /* every voluntary switch ends in a wakeup; sched has the exact count
+   * (including preempted wakeups) when the kernel exports it */
+  stats.wakeups = stats.voluntary_switches;
+  std::ifstream sched(task + "/sched");
+  while (std::getline(sched, line)) {
+    if (line.rfind("nr_wakeups ", 0) == 0) {
+      stats.wakeups = std::stoull(line.substr(line.find(':') + 1));
+      break;
+    }
+  }
+
+  counters.cpu_time = stats.cpu_time;
+  counters.switches = stats.voluntary_switches + stats.involuntary_switches;
+  counters.wakeups = stats.wakeups;
+  return stats;
+}
+
+std::vector<thread_stats> ThreadMonitor::sample() {
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - last_sample_).count();
+
+  std::vector<int> tids;
+  if (DIR *dir = opendir("/proc/self/task")) {
+    while (dirent *entry = readdir(dir)) {
+      if (entry->d_name[0] != '.') tids.push_back(std::atoi(entry->d_name));
+    }
+    closedir(dir);
+  }
+  std::sort(tids.begin(), tids.end());
+
+  std::vector<thread_stats> threads;
+  std::vector<std::pair<int, counters_>> counters;
+  for (int tid : tids) {
+    counters_ current;
+    auto stats = read_thread_(tid, current);
+    if (!stats) continue;  // exited while being read
+
+    auto last = std::find_if(
+        last_counters_.begin(), last_counters_.end(),
+        [tid](const std::pair<int, counters_> &c) { return c.first == tid; });
+    if (last != last_counters_.end() && elapsed > 0) {
+      stats->cpu_percent =
+          100.0 * (current.cpu_time - last->second.cpu_time) / elapsed;
+      stats->run_delay = current.run_delay - last->second.run_delay;
+      stats->switches_per_sec =
+          (current.switches - last->second.switches) / elapsed;
+      stats->wakeups_per_sec =
+          (current.wakeups - last->second.wakeups) / elapsed;
+    }
+    counters.push_back({tid, current});
+    threads.push_back(*stats);
+  }
+
+  last_counters_ = counters;
+  last_sample_ = now;
+  return threads;
+}
+
 }  // namespace Utilities
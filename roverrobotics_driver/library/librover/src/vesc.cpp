@@ -1,4 +1,5 @@
 #include "vesc.hpp"
+#include <cmath>
 #include <iostream>
 
 namespace vesc {
@@ -36,19 +37,37 @@ namespace vesc {
             float current = ((float)current_scaled) * CURRENT_SCALING_FACTOR;
             float duty = ((float)duty_scaled) * DUTY_SCALING_FACTOR;
 
+            /* temperatures arrive in a separate, slower packet; NaN until
+             * its first one */
+            float temp_fet = fetTemps_.count(vescId) ? fetTemps_[vescId] : NAN;
+            float temp_motor = motorTemps_.count(vescId) ? motorTemps_[vescId] : NAN;
+
             return (vescChannelStatus){.vescId = vescId,
                                     .current = current,
                                     .rpm = rpm,
                                     .duty = duty,
                                     .voltage = currentVoltage_,
                                     .current_in = currentAmperage_, 
-                                    .dataValid = true};
+                                    .dataValid = true,
+                                    .temp_fet = temp_fet,
+                                    .temp_motor = temp_motor};
             
         }
         else if (commandId == STATUS_COMMAND_ID_4)
         {
-            float amperage_scaled = (robotmsg[9] << 8) | (robotmsg[10]);
-            currentAmperage_ = ((float)amperage_scaled) * CURRENT_IN_SCALING_FACTOR;
+            int16_t temp_fet_scaled = (robotmsg[5] << 8) | (robotmsg[6]);
+            int16_t temp_motor_scaled = (robotmsg[7] << 8) | (robotmsg[8]);
+            fetTemps_[vescId] = ((float)temp_fet_scaled) * TEMP_SCALING_FACTOR;
+            motorTemps_[vescId] = ((float)temp_motor_scaled) * TEMP_SCALING_FACTOR;
+
+            /* each vesc reports its own input current; the battery supplies them all */
+            int16_t amperage_scaled = (robotmsg[9] << 8) | (robotmsg[10]);
+            inputCurrents_[vescId] = ((float)amperage_scaled) * CURRENT_IN_SCALING_FACTOR;
+            currentAmperage_ = 0;
+            for (auto &input_current : inputCurrents_)
+            {
+                currentAmperage_ += input_current.second;
+            }
 
             return (vescChannelStatus){
                 .vescId = 0, 
@@ -0,0 +1,331 @@
+// Offline odometry calibration.
+//
+// Fits the skid steer odometry model the driver uses
+// (computeVelocitiesFromWheelspeeds) to recorded drives:
+//   v = (r_left * w_left + r_right * w_right) / 2
+//   w = (r_right * w_right - r_left * w_left) / wheel_base
+// where w_* are wheel speeds (rad/s). Each drive is a wheel log and a
+// reference pose log (SLAM, mocap) as CSV:
+//   wheels: time, left_rpm, right_rpm   (wheel shaft rpm, or motor rpm with
+//                                        --gear-ratio)
+//   poses:  time, x, y, yaw             (m, rad; same clock as the wheels)
+// The logs are cut into short segments and the relative motion odometry
+// integrates over each one is compared with the reference. The parameters
+// are found with Levenberg-Marquardt; residuals and jacobians are evaluated
+// in parallel across segments. The result is written as driver parameters.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eigen3/Eigen/Dense"
+
+#define RPM_TO_RADS_SEC 0.10472
+
+namespace {
+struct wheel_sample {
+  double time;
+  double left;   // rad/s
+  double right;  // rad/s
+};
+
+struct pose_sample {
+  double time;
+  double x;
+  double y;
+  double yaw;  // unwrapped
+};
+
+struct drive {
+  std::vector<wheel_sample> wheels;
+  std::vector<pose_sample> poses;
+};
+
+struct segment {
+  const drive *log;
+  size_t begin;  // wheel sample indices, end inclusive
+  size_t end;
+  Eigen::Vector3d reference;  // end pose in the start frame (x, y, yaw)
+};
+
+// r_left, r_right, wheel_base
+using parameters = Eigen::Vector3d;
+
+struct options {
+  std::vector<std::string> wheel_files;
+  std::vector<std::string> pose_files;
+  std::string output = "odometry_calibration.yaml";
+  double wheel_radius = 0.08255;
+  double wheel_base = 0.28575;
+  double gear_ratio = 1.0;
+  double segment_length = 2.0;  // s
+  double yaw_weight = 1.0;      // m of position error per rad of yaw error
+  int iterations = 100;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+double wrapAngle(double angle) { return std::atan2(std::sin(angle), std::cos(angle)); }
+
+std::vector<std::vector<double>> readCsv(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "cannot open " << path << std::endl;
+    std::exit(1);
+  }
+  std::vector<std::vector<double>> rows;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    std::vector<double> row;
+    double value;
+    while (fields >> value) row.push_back(value);
+    // headers and comments do not parse as numbers
+    if (!row.empty() && fields.eof()) rows.push_back(row);
+  }
+  return rows;
+}
+
+drive loadDrive(const std::string &wheel_file, const std::string &pose_file,
+                double gear_ratio) {
+  drive log;
+  for (const auto &row : readCsv(wheel_file)) {
+    if (row.size() < 3) continue;
+    log.wheels.push_back({row[0], row[1] * gear_ratio * RPM_TO_RADS_SEC,
+                          row[2] * gear_ratio * RPM_TO_RADS_SEC});
+  }
+  for (const auto &row : readCsv(pose_file)) {
+    if (row.size() < 4) continue;
+    double yaw = row[3];
+    if (!log.poses.empty())
+      yaw = log.poses.back().yaw + wrapAngle(yaw - log.poses.back().yaw);
+    log.poses.push_back({row[0], row[1], row[2], yaw});
+  }
+  auto by_time = [](const auto &a, const auto &b) { return a.time < b.time; };
+  std::sort(log.wheels.begin(), log.wheels.end(), by_time);
+  std::sort(log.poses.begin(), log.poses.end(), by_time);
+  return log;
+}
+
+bool interpolatePose(const std::vector<pose_sample> &poses, double time,
+                     Eigen::Vector3d &pose) {
+  if (poses.size() < 2 || time < poses.front().time ||
+      time > poses.back().time)
+    return false;
+  auto after = std::lower_bound(
+      poses.begin(), poses.end(), time,
+      [](const pose_sample &p, double t) { return p.time < t; });
+  if (after == poses.begin()) after++;
+  auto before = after - 1;
+  double span = after->time - before->time;
+  double fraction = span > 0 ? (time - before->time) / span : 0;
+  pose << before->x + fraction * (after->x - before->x),
+      before->y + fraction * (after->y - before->y),
+      before->yaw + fraction * (after->yaw - before->yaw);
+  return true;
+}
+
+std::vector<segment> makeSegments(const std::vector<drive> &drives,
+                                  double length) {
+  std::vector<segment> segments;
+  for (const auto &log : drives) {
+    size_t begin = 0;
+    for (size_t i = 1; i < log.wheels.size(); i++) {
+      if (log.wheels[i].time - log.wheels[begin].time < length) continue;
+      Eigen::Vector3d start, end;
+      if (interpolatePose(log.poses, log.wheels[begin].time, start) &&
+          interpolatePose(log.poses, log.wheels[i].time, end)) {
+        double c = std::cos(start.z()), s = std::sin(start.z());
+        double dx = end.x() - start.x(), dy = end.y() - start.y();
+        segments.push_back({&log, begin, i,
+                            Eigen::Vector3d(c * dx + s * dy, -s * dx + c * dy,
+                                            end.z() - start.z())});
+      }
+      begin = i;
+    }
+  }
+  return segments;
+}
+
+// odometry over the segment, same integration as the driver
+Eigen::Vector3d integrate(const segment &seg, const parameters &p) {
+  double x = 0, y = 0, theta = 0;
+  const auto &wheels = seg.log->wheels;
+  for (size_t i = seg.begin; i < seg.end; i++) {
+    double dt = wheels[i + 1].time - wheels[i].time;
+    double left = p[0] * wheels[i].left, right = p[1] * wheels[i].right;
+    double linear = (left + right) / 2;
+    double angular = (right - left) / p[2];
+    x += linear * std::cos(theta) * dt;
+    y += linear * std::sin(theta) * dt;
+    theta += angular * dt;
+  }
+  return Eigen::Vector3d(x, y, theta);
+}
+
+Eigen::Vector3d residual(const segment &seg, const parameters &p,
+                         double yaw_weight) {
+  Eigen::Vector3d error = integrate(seg, p) - seg.reference;
+  error.z() *= yaw_weight;
+  return error;
+}
+
+// residuals (3 per segment) and their jacobian, segments split over threads
+void evaluate(const std::vector<segment> &segments, const parameters &p,
+              const options &opts, Eigen::VectorXd &residuals,
+              Eigen::MatrixXd *jacobian) {
+  residuals.resize(3 * segments.size());
+  if (jacobian) jacobian->resize(3 * segments.size(), 3);
+
+  auto work = [&](size_t first, size_t last) {
+    for (size_t n = first; n < last; n++) {
+      residuals.segment<3>(3 * n) = residual(segments[n], p, opts.yaw_weight);
+      if (!jacobian) continue;
+      for (int k = 0; k < 3; k++) {
+        double step = 1e-6 * std::max(1.0, std::abs(p[k]));
+        parameters plus = p, minus = p;
+        plus[k] += step;
+        minus[k] -= step;
+        jacobian->block<3, 1>(3 * n, k) =
+            (residual(segments[n], plus, opts.yaw_weight) -
+             residual(segments[n], minus, opts.yaw_weight)) /
+            (2 * step);
+      }
+    }
+  };
+
+  size_t chunk = (segments.size() + opts.threads - 1) / opts.threads;
+  std::vector<std::thread> workers;
+  for (size_t first = 0; first < segments.size(); first += chunk)
+    workers.emplace_back(work, first, std::min(segments.size(), first + chunk));
+  for (auto &worker : workers) worker.join();
+}
+
+double rms(const Eigen::VectorXd &residuals) {
+  return residuals.size() ? std::sqrt(residuals.squaredNorm() / residuals.size())
+                          : 0;
+}
+
+parameters levenbergMarquardt(const std::vector<segment> &segments,
+                              parameters p, const options &opts) {
+  Eigen::VectorXd r;
+  Eigen::MatrixXd J;
+  evaluate(segments, p, opts, r, &J);
+  double cost = r.squaredNorm();
+  double lambda = 1e-3;
+
+  for (int iteration = 0; iteration < opts.iterations; iteration++) {
+    Eigen::Matrix3d A = J.transpose() * J;
+    Eigen::Vector3d g = J.transpose() * r;
+    Eigen::Matrix3d damped = A;
+    damped.diagonal() += lambda * A.diagonal().cwiseMax(1e-12);
+    parameters delta = damped.ldlt().solve(-g);
+
+    parameters candidate = p + delta;
+    if (candidate.minCoeff() <= 0) {
+      lambda *= 10;
+      continue;
+    }
+    Eigen::VectorXd candidate_r;
+    evaluate(segments, candidate, opts, candidate_r, nullptr);
+    double candidate_cost = candidate_r.squaredNorm();
+
+    if (candidate_cost < cost) {
+      bool converged = (cost - candidate_cost) < 1e-12 * cost ||
+                       delta.norm() < 1e-10 * p.norm();
+      p = candidate;
+      cost = candidate_cost;
+      lambda = std::max(lambda / 10, 1e-12);
+      evaluate(segments, p, opts, r, &J);
+      if (converged) break;
+    } else {
+      lambda *= 10;
+      if (lambda > 1e12) break;
+    }
+  }
+  return p;
+}
+
+void usage() {
+  std::cerr
+      << "usage: odometry_calibration --wheels W.csv --poses P.csv "
+         "[--wheels W2.csv --poses P2.csv ...]\n"
+         "  [--wheel-radius 0.08255] [--wheel-base 0.28575] [--gear-ratio 1]\n"
+         "  [--segment 2.0] [--yaw-weight 1.0] [--iterations 100]\n"
+         "  [--threads N] [--output odometry_calibration.yaml]\n";
+  std::exit(1);
+}
+
+options parseOptions(int argc, char **argv) {
+  options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) usage();
+    std::string value = argv[++i];
+    if (arg == "--wheels") opts.wheel_files.push_back(value);
+    else if (arg == "--poses") opts.pose_files.push_back(value);
+    else if (arg == "--output") opts.output = value;
+    else if (arg == "--wheel-radius") opts.wheel_radius = std::stod(value);
+    else if (arg == "--wheel-base") opts.wheel_base = std::stod(value);
+    else if (arg == "--gear-ratio") opts.gear_ratio = std::stod(value);
+    else if (arg == "--segment") opts.segment_length = std::stod(value);
+    else if (arg == "--yaw-weight") opts.yaw_weight = std::stod(value);
+    else if (arg == "--iterations") opts.iterations = std::stoi(value);
+    else if (arg == "--threads") opts.threads = std::max(1, std::stoi(value));
+    else usage();
+  }
+  if (opts.wheel_files.empty() ||
+      opts.wheel_files.size() != opts.pose_files.size())
+    usage();
+  return opts;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  options opts = parseOptions(argc, argv);
+
+  std::vector<drive> drives;
+  for (size_t n = 0; n < opts.wheel_files.size(); n++)
+    drives.push_back(
+        loadDrive(opts.wheel_files[n], opts.pose_files[n], opts.gear_ratio));
+  std::vector<segment> segments = makeSegments(drives, opts.segment_length);
+  if (segments.size() < 3) {
+    std::cerr << "need at least 3 segments covered by both logs, have "
+              << segments.size() << std::endl;
+    return 1;
+  }
+
+  parameters initial(opts.wheel_radius, opts.wheel_radius, opts.wheel_base);
+  Eigen::VectorXd before, after;
+  evaluate(segments, initial, opts, before, nullptr);
+  parameters p = levenbergMarquardt(segments, initial, opts);
+  evaluate(segments, p, opts, after, nullptr);
+
+  double radius = (p[0] + p[1]) / 2;
+  std::cout << std::setprecision(6) << segments.size() << " segments, rms error "
+            << rms(before) << " -> " << rms(after) << "\n"
+            << "left/right wheel radius " << p[0] << " / " << p[1]
+            << ", wheel base " << p[2] << std::endl;
+
+  std::ofstream out(opts.output);
+  out << std::setprecision(6)
+      << "# odometry_calibration: " << segments.size()
+      << " segments, rms error " << rms(before) << " -> " << rms(after) << "\n"
+      << "# left/right wheel radius " << p[0] << " / " << p[1]
+      << " (the difference is drift the driver trim can take up)\n"
+      << "# pro: divide MOTOR_RPM_TO_MPS_RATIO_ by " << radius / opts.wheel_radius
+      << ", odom_angular_coef_ * odom_traction_factor_ = " << 1 / p[2] << "\n"
+      << "roverrobotics_driver:\n"
+      << "  ros__parameters:\n"
+      << "    wheel_radius: " << radius << "\n"
+      << "    wheel_base: " << p[2] << "\n";
+  std::cout << "wrote " << opts.output << std::endl;
+  return 0;
+}
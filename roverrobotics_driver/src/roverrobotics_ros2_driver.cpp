@@ -1,4 +1,10 @@
 #include "roverrobotics_ros2_driver.hpp"
+
+#if __has_include("rclcpp/experimental/executors/events_executor/events_executor.hpp")
+#include "rclcpp/experimental/executors/events_executor/events_executor.hpp"
+#define ROVER_HAS_EVENTS_EXECUTOR
+#endif
+
 using namespace RoverRobotics;
 #include <iostream>
 
@@ -17,6 +23,32 @@ double mapValue(double x, double inMin, double inMax, double outMin, double outM
   }
 }
 
+// The executor creates its worker threads inside spin(), so each names itself
+// on its first callback; rclcpp and dds threads keep the process name
+static void name_executor_thread() {
+  thread_local bool named = false;
+  if (!named) {
+    Utilities::set_thread_name("rover_executor");
+    named = true;
+  }
+}
+
+// Gains are listed row-major by speed; empty i/d lists mean zero
+static Control::gain_schedule make_gain_schedule(
+    const std::vector<double> &speeds, const std::vector<double> &voltages,
+    const std::vector<double> &p, const std::vector<double> &i,
+    const std::vector<double> &d) {
+  Control::gain_schedule schedule;
+  schedule.speed_breakpoints.assign(speeds.begin(), speeds.end());
+  schedule.voltage_breakpoints.assign(voltages.begin(), voltages.end());
+  size_t size = std::max({p.size(), i.size(), d.size()});
+  for (size_t n = 0; n < size; n++) {
+    schedule.gains.push_back({n < p.size() ? p[n] : 0, n < i.size() ? i[n] : 0,
+                              n < d.size() ? d[n] : 0});
+  }
+  return schedule;
+}
+
 RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_intra_process_comms(false)), linear_accumulator_(10),
   angular_accumulator_(10){
   RCLCPP_INFO(get_logger(), "Starting Rover Driver node");
@@ -51,6 +83,8 @@ RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_int
   float pi_p_ = declare_parameter("motor_control_p_gain", PID_P_DEFAULT_);
   float pi_i_ = declare_parameter("motor_control_i_gain", PID_I_DEFAULT_);
   float pi_d_ = declare_parameter("motor_control_d_gain", PID_D_DEFAULT_);
+  delay_compensation_ =
+      declare_parameter("delay_compensation", DELAY_COMPENSATION_DEFAULT_);
   linear_covariance = declare_parameter("linear_covariance", LIN_COVAR_DEFAULT);
   yaw_covariance = declare_parameter("yaw_covariance", YAW_COVAR_DEFAULT);
   
@@ -61,9 +95,27 @@ RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_int
   odom_topic_ = declare_parameter("odom_topic", "/odom_raw");
   odometry_frequency_ =
       declare_parameter("odometry_frequency", ROBOT_ODOM_FREQUENCY_DEFAULT_);
+  diagnostics_frequency_ = declare_parameter("diagnostics_frequency",
+                                             DIAGNOSTICS_FREQUENCY_DEFAULT_);
+  // read by main, which builds the executor
+  declare_parameter("executor_type", EXECUTOR_TYPE_DEFAULT_);
+  declare_parameter("executor_threads", EXECUTOR_THREADS_DEFAULT_);
+  telemetry_stale_timeout_ = std::chrono::milliseconds(int64_t(
+      1000 * declare_parameter("telemetry_stale_timeout",
+                               TELEMETRY_STALE_TIMEOUT_DEFAULT_)));
   odom_frame_id_ = declare_parameter("odom_frame_id", "odom");
   odom_child_frame_id_ =
       declare_parameter("odom_child_frame_id", "base_link");
+  // Imu Fusion
+  imu_fusion_enabled_ = declare_parameter("imu_fusion", IMU_FUSION_DEFAULT_);
+  imu_topic_ = declare_parameter("imu_topic", IMU_TOPIC_DEFAULT_);
+  float imu_gyro_weight_ =
+      declare_parameter("imu_gyro_weight", IMU_GYRO_WEIGHT_DEFAULT_);
+  float imu_adaptation_rate_ =
+      declare_parameter("imu_adaptation_rate", IMU_ADAPTATION_RATE_DEFAULT_);
+  yaw_fusion_ = std::make_unique<Control::YawRateFusion>(imu_gyro_weight_,
+                                                         imu_adaptation_rate_);
+  imu_last_time_ = rclcpp::Time(0, 0, get_clock()->get_clock_type());
   // Angular Scaling params
   angular_scaling_params_.a_coef =
       declare_parameter("angular_a_coef", ANGULAR_SCALING_A_DEFAULT_);
@@ -78,7 +130,7 @@ RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_int
   // Finished getting all parameters
   RCLCPP_INFO(get_logger(),
               "Robot type is Rover %s over %s", robot_type_.c_str(), comm_type_.c_str());
-  RCLCPP_INFO(get_logger(), "Receiving velocity command from %s", speed_topic_.c_str());
+
   if (estop_state_)
     RCLCPP_INFO(get_logger(), "Estop state is currently active");
   else
@@ -89,32 +141,82 @@ RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_int
  
   
   // Init Sub
-  speed_command_subscriber_ = create_subscription<geometry_msgs::msg::Twist>(
-      speed_topic_, rclcpp::QoS(1),
-      [=](geometry_msgs::msg::Twist::ConstSharedPtr msg) {
-        velocity_event_callback(msg);
-      });
+  auto command_source_names = declare_parameter(
+      "command_source_names", std::vector<std::string>{});
+  for (auto &name : command_source_names) {
+    auto source = std::make_unique<CommandSource>();
+    std::string prefix = "command_sources." + name + ".";
+    source->name = name;
+    source->topic = declare_parameter(prefix + "topic", "/" + name + "/cmd_vel");
+    source->priority = declare_parameter(prefix + "priority", 0);
+    source->timeout_ns = rclcpp::Duration::from_seconds(
+        declare_parameter(prefix + "timeout", COMMAND_SOURCE_TIMEOUT_DEFAULT_))
+        .nanoseconds();
+    source->linear_limit =
+        declare_parameter(prefix + "linear_limit", linear_top_speed_);
+    source->angular_limit =
+        declare_parameter(prefix + "angular_limit", angular_top_speed_);
+    command_sources_.push_back(std::move(source));
+  }
+  if (command_sources_.empty()) {
+    RCLCPP_INFO(get_logger(), "Receiving velocity command from %s", speed_topic_.c_str());
+    speed_command_subscriber_ = create_subscription<geometry_msgs::msg::Twist>(
+        speed_topic_, rclcpp::QoS(1),
+        [=](geometry_msgs::msg::Twist::ConstSharedPtr msg) {
+          name_executor_thread();
+          velocity_event_callback(msg);
+        });
+  } else {
+    for (size_t i = 0; i < command_sources_.size(); i++) {
+      auto &source = command_sources_[i];
+      source->subscriber = create_subscription<geometry_msgs::msg::Twist>(
+          source->topic, rclcpp::QoS(1),
+          [=](geometry_msgs::msg::Twist::ConstSharedPtr msg) {
+            name_executor_thread();
+            command_source_callback(i, msg);
+          });
+      RCLCPP_INFO(get_logger(),
+                  "Receiving velocity command source %s from %s (priority %d)",
+                  source->name.c_str(), source->topic.c_str(),
+                  source->priority);
+    }
+  }
   trim_event_subscriber_ = create_subscription<std_msgs::msg::Float32>(
       trim_topic_, rclcpp::QoS(3),
       [=](std_msgs::msg::Float32::ConstSharedPtr msg) {
+        name_executor_thread();
         trim_event_callback(msg);
       });
   estop_trigger_subscriber_ = create_subscription<std_msgs::msg::Bool>(
       estop_trigger_topic_, rclcpp::QoS(2),
       [=](std_msgs::msg::Bool::ConstSharedPtr msg) {
+        name_executor_thread();
         estop_trigger_event_callback(msg);
       });
   estop_reset_subscriber_ = create_subscription<std_msgs::msg::Bool>(
       estop_reset_topic_, rclcpp::QoS(2),
       [=](std_msgs::msg::Bool::ConstSharedPtr msg) {
+        name_executor_thread();
         estop_reset_event_callback(msg);
       });
   robot_info__request_subscriber_ = create_subscription<std_msgs::msg::Bool>(
       estop_reset_topic_, rclcpp::QoS(2),
       [=](std_msgs::msg::Bool::ConstSharedPtr msg) {
+        name_executor_thread();
         robot_info_request_callback(msg);
       });
 
+  if (imu_fusion_enabled_) {
+    imu_subscriber_ = create_subscription<sensor_msgs::msg::Imu>(
+        imu_topic_, rclcpp::SensorDataQoS(),
+        [=](sensor_msgs::msg::Imu::ConstSharedPtr msg) {
+          name_executor_thread();
+          imu_event_callback(msg);
+        });
+    RCLCPP_INFO(get_logger(), "Fusing imu yaw rate from %s into odometry",
+                imu_topic_.c_str());
+  }
+
   // Init Pub
 
   robot_info_publisher = create_publisher<std_msgs::msg::Float32MultiArray>(
@@ -132,14 +234,32 @@ RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_int
   odometry_publisher_ =
         create_publisher<nav_msgs::msg::Odometry>(odom_topic_, rclcpp::QoS(4));
 
-  odometry_timer_ =
-        create_wall_timer(1s / odometry_frequency_, [=]() { update_odom(); });
-  robot_status_timer_ = create_wall_timer(1s / robot_status_frequency_,
-                                          [=]() { publish_robot_status(); });
+  // Timers run on the node clock so they follow /clock under use_sim_time
+  odometry_timer_ = rclcpp::create_timer(
+      this, get_clock(), rclcpp::Duration::from_seconds(1.0 / odometry_frequency_),
+      [=]() {
+        time_callback(odometry_timing_, 1.0 / odometry_frequency_,
+                      [=]() { update_odom(); });
+      });
+  robot_status_timer_ = rclcpp::create_timer(
+      this, get_clock(),
+      rclcpp::Duration::from_seconds(1.0 / robot_status_frequency_), [=]() {
+        time_callback(robot_status_timing_, 1.0 / robot_status_frequency_,
+                      [=]() { publish_robot_status(); });
+      });
   RCLCPP_INFO(
       get_logger(),
       "Publishing Robot status on %s at %.2Fhz",
       robot_status_topic_.c_str(), robot_status_frequency_);
+  // cpu usage is measured against the wall clock, so this stays a wall timer
+  diagnostics_publisher_ = create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+      "/diagnostics", rclcpp::QoS(10));
+  if (diagnostics_frequency_ > 0) {
+    diagnostics_timer_ = create_wall_timer(1s / diagnostics_frequency_, [=]() {
+      name_executor_thread();
+      publish_diagnostics();
+    });
+  }
 
 
   // Init Pid
@@ -156,6 +276,19 @@ RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_int
     RCLCPP_INFO(get_logger(), "Closed Loop Control is Disabled and Control Mode is in OPEN LOOP");
   }
   pid_gains_ = {pi_p_, pi_i_, pi_d_};
+  // librover's control loops and thread sleeps follow the ROS clock in sim
+  if (get_parameter("use_sim_time").as_bool()) {
+    auto clock = get_clock();
+    Utilities::RoverClock::set_time_source(
+        {[clock]() { return clock->now().nanoseconds(); },
+         [clock](int64_t time) {
+           // false once ROS is shut down, which stops librover's loops
+           return clock->sleep_until(
+                      rclcpp::Time(time, clock->get_clock_type())) ||
+                  rclcpp::ok();
+         }});
+    RCLCPP_INFO(get_logger(), "Robot control loops are running on sim time");
+  }
   // initialize connection to robot
   RCLCPP_INFO(get_logger(), "Connecting to robot at %s", device_port_.c_str());
   if (robot_type_ == "pro") {
@@ -213,11 +346,121 @@ RobotDriver::RobotDriver() : Node("roverrobotics", rclcpp::NodeOptions().use_int
       return;
     }
     RCLCPP_INFO(get_logger(), "Connected to robot at %s", device_port_.c_str());
+  } else if (robot_type_ == "sim") {
+    robot_ = std::make_unique<SimulatedProtocolObject>(
+        control_mode_, wheel_radius_, wheel_base_, robot_length_, pid_gains_,
+        angular_scaling_params_);
+    RCLCPP_INFO(get_logger(), "Connected to a simulated robot");
   } else {
     RCLCPP_WARN(get_logger(),
                 "Robot Type is currently not suppported. Stopping this Node");
     rclcpp::shutdown();
+    return;
   }
+
+  // Compensate wheel speed feedback for the telemetry delay
+  robot_->set_delay_compensation(delay_compensation_);
+  if (delay_compensation_)
+    RCLCPP_INFO(get_logger(), "Telemetry delay compensation is enabled");
+
+  // Export telemetry through shared memory (see rover_telemetry.h)
+  auto telemetry_shm_name =
+      declare_parameter("telemetry_shm_name", TELEMETRY_SHM_NAME_DEFAULT_);
+  auto telemetry_shm_frequency = declare_parameter(
+      "telemetry_shm_frequency", TELEMETRY_SHM_FREQUENCY_DEFAULT_);
+  if (!telemetry_shm_name.empty() && !(telemetry_shm_frequency > 0)) {
+    RCLCPP_WARN(get_logger(), "telemetry_shm_frequency must be > 0; telemetry is not exported");
+  } else if (!telemetry_shm_name.empty()) {
+    try {
+      telemetry_exporter_ = std::make_unique<TelemetryExporter>(
+          robot_.get(), telemetry_shm_name, telemetry_shm_frequency);
+      RCLCPP_INFO(get_logger(), "Exporting telemetry to shared memory %s at %.2Fhz",
+                  telemetry_shm_name.c_str(), telemetry_shm_frequency);
+    } catch (int i) {
+      RCLCPP_WARN(get_logger(), "Could not create shared memory %s; telemetry is not exported",
+                  telemetry_shm_name.c_str());
+    }
+  }
+
+  // Limits default to what the robot protocol already uses
+  auto control_config = robot_->get_control_config();
+  control_config.acceleration_limits.linear_velocity = declare_parameter(
+      "linear_acceleration_limit",
+      control_config.acceleration_limits.linear_velocity);
+  control_config.acceleration_limits.angular_velocity = declare_parameter(
+      "angular_acceleration_limit",
+      control_config.acceleration_limits.angular_velocity);
+  control_config.geometric_decay =
+      declare_parameter("geometric_decay", control_config.geometric_decay);
+  auto &thermal = control_config.thermal;
+  thermal.enabled = declare_parameter("thermal_derating", thermal.enabled);
+  thermal.motor.limit =
+      declare_parameter("thermal_motor_limit", thermal.motor.limit);
+  thermal.motor.time_constant = declare_parameter(
+      "thermal_motor_time_constant", thermal.motor.time_constant);
+  thermal.motor.heating_coef = declare_parameter(
+      "thermal_motor_heating_coef", thermal.motor.heating_coef);
+  thermal.mosfet.limit =
+      declare_parameter("thermal_mosfet_limit", thermal.mosfet.limit);
+  thermal.mosfet.time_constant = declare_parameter(
+      "thermal_mosfet_time_constant", thermal.mosfet.time_constant);
+  thermal.mosfet.heating_coef = declare_parameter(
+      "thermal_mosfet_heating_coef", thermal.mosfet.heating_coef);
+  thermal.ambient = declare_parameter("thermal_ambient", thermal.ambient);
+  thermal.horizon = declare_parameter("thermal_horizon", thermal.horizon);
+  thermal.min_factor =
+      declare_parameter("thermal_min_factor", thermal.min_factor);
+  auto &current_limits = control_config.current_limits;
+  current_limits.enabled =
+      declare_parameter("current_limiting", current_limits.enabled);
+  current_limits.motor_current_budget = declare_parameter(
+      "motor_current_budget", current_limits.motor_current_budget);
+  current_limits.battery_current_budget = declare_parameter(
+      "battery_current_budget", current_limits.battery_current_budget);
+  current_limits.max_boost =
+      declare_parameter("acceleration_max_boost", current_limits.max_boost);
+  current_limits.min_scale =
+      declare_parameter("acceleration_min_scale", current_limits.min_scale);
+  control_config.schedule = make_gain_schedule(
+      declare_parameter("gain_schedule_speeds", std::vector<double>{}),
+      declare_parameter("gain_schedule_voltages", std::vector<double>{}),
+      declare_parameter("gain_schedule_p", std::vector<double>{}),
+      declare_parameter("gain_schedule_i", std::vector<double>{}),
+      declare_parameter("gain_schedule_d", std::vector<double>{}));
+  std::string reason;
+  if (Control::validateControlConfig(control_config, reason)) {
+    robot_->update_control_config(control_config);
+    if (thermal.enabled)
+      RCLCPP_INFO(get_logger(),
+                  "Thermal derating is enabled (motor %.0fC, mosfet %.0fC)",
+                  thermal.motor.limit, thermal.mosfet.limit);
+    if (current_limits.enabled)
+      RCLCPP_INFO(get_logger(),
+                  "Acceleration follows current budgets (motor %.1fA, battery %.1fA)",
+                  current_limits.motor_current_budget,
+                  current_limits.battery_current_budget);
+    if (!control_config.schedule.gains.empty())
+      RCLCPP_INFO(get_logger(),
+                  "Gain scheduling over %zu speed x %zu voltage breakpoints",
+                  control_config.schedule.speed_breakpoints.size(),
+                  control_config.schedule.voltage_breakpoints.size());
+  } else {
+    RCLCPP_WARN(get_logger(), "Ignoring configured control limits: %s",
+                reason.c_str());
+  }
+
+  // Gains, limits and geometry can be tuned while the robot is running
+  parameter_callback_handle_ = add_on_set_parameters_callback(
+      [=](const std::vector<rclcpp::Parameter> &parameters) {
+        name_executor_thread();
+        return parameters_event_callback(parameters);
+      });
+}
+
+RobotDriver::~RobotDriver() {
+  // the time source captures this node's clock; robot_ and the exporter are
+  // destroyed after this body and their loops must not sleep on it
+  Utilities::RoverClock::reset_time_source();
 }
 
 void RobotDriver::publish_robot_info() {
@@ -240,6 +483,94 @@ void RobotDriver::publish_robot_info() {
   robot_info_publisher->publish(robot_info);
 }
 
+bool RobotDriver::is_stale(const field_stamp &stamp) {
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Utilities::RoverClock::now().time_since_epoch());
+  return RoverRobotics::is_stale(stamp, now, telemetry_stale_timeout_);
+}
+
+void RobotDriver::time_callback(CallbackTiming &timing, double period,
+                                const std::function<void()> &callback) {
+  name_executor_thread();
+  auto start = std::chrono::steady_clock::now();
+  callback();
+  auto end = std::chrono::steady_clock::now();
+  auto to_ms = [](std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+  };
+
+  std::lock_guard<std::mutex> lock(callback_timing_mutex_);
+  // a late start shows as a longer gap since the previous one; the gap is
+  // wall time, so it says nothing about the schedule under sim time
+  if (timing.last_start.time_since_epoch().count() != 0 &&
+      !get_clock()->ros_time_is_active()) {
+    double delay =
+        std::max(0.0, to_ms(start - timing.last_start) - 1000 * period);
+    timing.delays++;
+    timing.delay_sum += delay;
+    timing.delay_max = std::max(timing.delay_max, delay);
+  }
+  timing.last_start = start;
+  double run = to_ms(end - start);
+  timing.runs++;
+  timing.run_sum += run;
+  timing.run_max = std::max(timing.run_max, run);
+}
+
+void RobotDriver::publish_diagnostics() {
+  auto diagnostics = diagnostic_msgs::msg::DiagnosticArray();
+  diagnostics.header.stamp = get_clock()->now();
+  auto value = [](const std::string &key, double value) {
+    diagnostic_msgs::msg::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = std::to_string(value);
+    return key_value;
+  };
+  for (const auto &thread : thread_monitor_.sample()) {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.name = std::string(get_name()) + ": thread " + thread.name + " (" +
+                  std::to_string(thread.tid) + ")";
+    status.hardware_id = robot_type_;
+    char message[64];
+    snprintf(message, sizeof(message), "%.1f%% cpu", thread.cpu_percent);
+    status.message = message;
+    status.values.push_back(value("cpu_percent", thread.cpu_percent));
+    status.values.push_back(value("cpu_time", thread.cpu_time));
+    status.values.push_back(value("run_delay", thread.run_delay));
+    status.values.push_back(
+        value("voluntary_switches", thread.voluntary_switches));
+    status.values.push_back(
+        value("involuntary_switches", thread.involuntary_switches));
+    status.values.push_back(value("switches_per_sec", thread.switches_per_sec));
+    status.values.push_back(value("wakeups", thread.wakeups));
+    status.values.push_back(value("wakeups_per_sec", thread.wakeups_per_sec));
+    diagnostics.status.push_back(status);
+  }
+  std::lock_guard<std::mutex> lock(callback_timing_mutex_);
+  for (auto *timing : {&odometry_timing_, &robot_status_timing_}) {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.name = std::string(get_name()) + ": callback " + timing->name;
+    status.hardware_id = robot_type_;
+    double delay_mean = timing->delays ? timing->delay_sum / timing->delays : 0;
+    double run_mean = timing->runs ? timing->run_sum / timing->runs : 0;
+    char message[64];
+    snprintf(message, sizeof(message), "%.2f ms late, %.2f ms run",
+             delay_mean, run_mean);
+    status.message = message;
+    status.values.push_back(value("runs", timing->runs));
+    status.values.push_back(value("delay_mean_ms", delay_mean));
+    status.values.push_back(value("delay_max_ms", timing->delay_max));
+    status.values.push_back(value("run_mean_ms", run_mean));
+    status.values.push_back(value("run_max_ms", timing->run_max));
+    diagnostics.status.push_back(status);
+    // keep last_start so the next period's first delay is measured
+    *timing = CallbackTiming{timing->name, timing->last_start};
+  }
+  diagnostics_publisher_->publish(diagnostics);
+}
+
 void RobotDriver::publish_robot_status() {
   // std::cerr << robot_->is_connected() << std::endl;
   if (!robot_->is_connected()) {
@@ -252,56 +583,113 @@ void RobotDriver::publish_robot_status() {
   robot_data_ = robot_->status_request();
   std_msgs::msg::Float32MultiArray robot_status;
   robot_status.data.clear();
+  // Fields whose group stopped arriving (or never did) are published as NaN
+  auto fresh = [this](const field_stamp &stamp, float value) {
+    return is_stale(stamp) ? std::numeric_limits<float>::quiet_NaN() : value;
+  };
   // Motor Infos
   robot_status.data.push_back(robot_data_.motor1_id);
-  robot_status.data.push_back(robot_data_.motor1_rpm);
-  robot_status.data.push_back(robot_data_.motor1_current);
-  robot_status.data.push_back(robot_data_.motor1_temp);
-  robot_status.data.push_back(robot_data_.motor1_mos_temp);
+  robot_status.data.push_back(
+      fresh(robot_data_.motor1_stamp, robot_data_.motor1_rpm));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor1_stamp, robot_data_.motor1_current));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor1_stamp, robot_data_.motor1_temp));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor1_stamp, robot_data_.motor1_mos_temp));
   robot_status.data.push_back(robot_data_.motor2_id);
-  robot_status.data.push_back(robot_data_.motor2_rpm);
-  robot_status.data.push_back(robot_data_.motor2_current);
-  robot_status.data.push_back(robot_data_.motor2_temp);
-  robot_status.data.push_back(robot_data_.motor2_mos_temp);
+  robot_status.data.push_back(
+      fresh(robot_data_.motor2_stamp, robot_data_.motor2_rpm));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor2_stamp, robot_data_.motor2_current));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor2_stamp, robot_data_.motor2_temp));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor2_stamp, robot_data_.motor2_mos_temp));
   robot_status.data.push_back(robot_data_.motor3_id);
-  robot_status.data.push_back(robot_data_.motor3_rpm);
-  robot_status.data.push_back(robot_data_.motor3_current);
-  robot_status.data.push_back(robot_data_.motor3_temp);
-  robot_status.data.push_back(robot_data_.motor3_mos_temp);
+  robot_status.data.push_back(
+      fresh(robot_data_.motor3_stamp, robot_data_.motor3_rpm));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor3_stamp, robot_data_.motor3_current));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor3_stamp, robot_data_.motor3_temp));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor3_stamp, robot_data_.motor3_mos_temp));
   robot_status.data.push_back(robot_data_.motor4_id);
-  robot_status.data.push_back(robot_data_.motor4_rpm);
-  robot_status.data.push_back(robot_data_.motor4_current);
-  robot_status.data.push_back(robot_data_.motor4_temp);
-  robot_status.data.push_back(robot_data_.motor4_mos_temp);
+  robot_status.data.push_back(
+      fresh(robot_data_.motor4_stamp, robot_data_.motor4_rpm));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor4_stamp, robot_data_.motor4_current));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor4_stamp, robot_data_.motor4_temp));
+  robot_status.data.push_back(
+      fresh(robot_data_.motor4_stamp, robot_data_.motor4_mos_temp));
   // Battery Infos
-  robot_status.data.push_back(robot_data_.battery1_voltage);
-  robot_status.data.push_back(robot_data_.battery2_voltage);
-  robot_status.data.push_back(robot_data_.battery1_temp);
-  robot_status.data.push_back(robot_data_.battery2_temp);
-  robot_status.data.push_back(robot_data_.battery1_current);
-  robot_status.data.push_back(robot_data_.battery2_current);
-  robot_status.data.push_back(robot_data_.battery1_SOC);
-  robot_status.data.push_back(robot_data_.battery2_SOC);
-  robot_status.data.push_back(robot_data_.battery1_fault_flag);
-  robot_status.data.push_back(robot_data_.battery2_fault_flag);
+  robot_status.data.push_back(
+      fresh(robot_data_.battery1_stamp, robot_data_.battery1_voltage));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery2_stamp, robot_data_.battery2_voltage));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery1_stamp, robot_data_.battery1_temp));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery2_stamp, robot_data_.battery2_temp));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery1_stamp, robot_data_.battery1_current));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery2_stamp, robot_data_.battery2_current));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery1_stamp, robot_data_.battery1_SOC));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery2_stamp, robot_data_.battery2_SOC));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery1_stamp, robot_data_.battery1_fault_flag));
+  robot_status.data.push_back(
+      fresh(robot_data_.battery2_stamp, robot_data_.battery2_fault_flag));
 
   // Flipper Infos
-  robot_status.data.push_back(robot_data_.motor3_angle);
-  robot_status.data.push_back(robot_data_.motor3_sensor1);
-  robot_status.data.push_back(robot_data_.motor3_sensor2);
+  robot_status.data.push_back(
+      fresh(robot_data_.flipper_stamp, robot_data_.motor3_angle));
+  robot_status.data.push_back(
+      fresh(robot_data_.flipper_stamp, robot_data_.motor3_sensor1));
+  robot_status.data.push_back(
+      fresh(robot_data_.flipper_stamp, robot_data_.motor3_sensor2));
+
+  // Link Latency Infos
+  robot_status.data.push_back(robot_data_.comm_round_trip_ms);
+  robot_status.data.push_back(robot_data_.telemetry_age_ms);
+
+  // Thermal Derating Infos
+  robot_status.data.push_back(robot_data_.thermal_derate_factor);
+  robot_status.data.push_back(robot_data_.thermal_time_to_limit);
+
+  // Current-Aware Acceleration Infos
+  robot_status.data.push_back(robot_data_.acceleration_scale);
+
+  // Telemetry Freshness Infos (age in ms, inf if never received)
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Utilities::RoverClock::now().time_since_epoch());
+  for (const auto &stamp :
+       {robot_data_.motor1_stamp, robot_data_.motor2_stamp,
+        robot_data_.motor3_stamp, robot_data_.motor4_stamp,
+        robot_data_.battery1_stamp, robot_data_.battery2_stamp,
+        robot_data_.robot_info_stamp, robot_data_.flipper_stamp}) {
+    robot_status.data.push_back(
+        stamp.sequence == 0 ? std::numeric_limits<float>::infinity()
+                            : float((now - stamp.time).count()));
+  }
   robot_status_publisher_->publish(robot_status);
 
 
   // Battery Status Topic
   auto battery_msg = sensor_msgs::msg::BatteryState();
   if (robot_type_ != "pro"){
-    battery_msg.percentage = robot_data_.battery1_SOC;
-    battery_msg.voltage = robot_data_.battery1_voltage;
-    battery_msg.current = robot_data_.battery1_current;
+    battery_msg.percentage = fresh(robot_data_.battery1_stamp, robot_data_.battery1_SOC);
+    battery_msg.voltage = fresh(robot_data_.battery1_stamp, robot_data_.battery1_voltage);
+    battery_msg.current = fresh(robot_data_.battery1_stamp, robot_data_.battery1_current);
   } else {
-    battery_msg.percentage = mapValue(robot_data_.battery1_SOC, inMin, inMax, outMin, outMax);
-    battery_msg.voltage = robot_data_.battery1_SOC/29.94; //pro firmware reports voltage max as 970 and min as 770, hence the nu. is divided by 29.94 to get the value in the actual range 
-    battery_msg.current = robot_data_.battery2_current;
+    battery_msg.percentage = fresh(robot_data_.battery1_stamp, mapValue(robot_data_.battery1_SOC, inMin, inMax, outMin, outMax));
+    battery_msg.voltage = fresh(robot_data_.battery1_stamp, robot_data_.battery1_SOC/29.94); //pro firmware reports voltage max as 970 and min as 770, hence the nu. is divided by 29.94 to get the value in the actual range 
+    battery_msg.current = fresh(robot_data_.battery2_stamp, robot_data_.battery2_current);
   }
   battery_soc_publisher_->publish(battery_msg);
 }
@@ -346,6 +734,14 @@ void RobotDriver::update_odom() {
   
   dt = now_time - past_time;
   past_time = now_time;
+
+  // Wheel speeds that stopped arriving are not integrated; the odometry stops
+  // rather than carrying the last velocity forward
+  if (is_stale(robot_data_.motor1_stamp) || is_stale(robot_data_.motor2_stamp)) {
+    RCLCPP_WARN_THROTTLE(get_logger(), *get_clock(), 5000,
+                         "Wheel speed telemetry is stale; not updating odometry");
+    return;
+  }
   
   linear_accumulator_.accumulate(robot_data_.linear_vel);
   angular_accumulator_.accumulate(robot_data_.angular_vel);
@@ -353,6 +749,15 @@ void RobotDriver::update_odom() {
   mean_linear = linear_accumulator_.getRollingMean();
   mean_angular = angular_accumulator_.getRollingMean();
 
+  // Use the gyro fused yaw rate; without it, still apply the learned traction
+  // factor
+  if (imu_fusion_enabled_) {
+    if (imu_is_fresh())
+      mean_angular = imu_fused_yaw_rate_;
+    else
+      mean_angular = yaw_fusion_->correctWheelYawRate(mean_angular);
+  }
+
   // Calculate position
   if (past_time != 0)
   {
@@ -397,6 +802,23 @@ void RobotDriver::update_odom() {
   }
 }
 
+void RobotDriver::imu_event_callback(
+    sensor_msgs::msg::Imu::ConstSharedPtr msg) {
+  imu_yaw_rate_ = msg->angular_velocity.z;
+  imu_last_time_ = get_clock()->now();
+  // Fuse against the wheel yaw rate sampled with the gyro; the odometry's
+  // rolling mean lags it and would bias the traction factor
+  auto data = robot_->status_request();
+  if (is_stale(data.motor1_stamp) || is_stale(data.motor2_stamp)) return;
+  imu_fused_yaw_rate_ =
+      yaw_fusion_->update(imu_yaw_rate_, data.angular_vel, data.linear_vel);
+}
+
+bool RobotDriver::imu_is_fresh() {
+  return imu_fusion_enabled_ &&
+         (get_clock()->now() - imu_last_time_).seconds() < IMU_TIMEOUT_S_;
+}
+
 void RobotDriver::velocity_event_callback(
     geometry_msgs::msg::Twist::ConstSharedPtr msg) {
   if (!robot_->is_connected()) {
@@ -412,6 +834,187 @@ void RobotDriver::velocity_event_callback(
   robot_->set_robot_velocity(speeddata);
 }
 
+void RobotDriver::command_source_callback(
+    size_t source, geometry_msgs::msg::Twist::ConstSharedPtr msg) {
+  if (!robot_->is_connected()) {
+    RCLCPP_FATAL(
+        get_logger(),
+        "Did not receive any data from the robot or the data is stale. Check that the robot is connected to the computer and that permissions are set correctly.");
+    rclcpp::shutdown();
+  }
+  auto &commander = *command_sources_[source];
+  int64_t now = get_clock()->now().nanoseconds();
+  commander.last_command_ns.store(now, std::memory_order_release);
+
+  // Drop the command while a higher priority source is still active
+  for (auto &other : command_sources_) {
+    if (other->priority <= commander.priority) continue;
+    int64_t last = other->last_command_ns.load(std::memory_order_acquire);
+    if (last != CommandSource::NEVER_RECEIVED_NS &&
+        now - last < other->timeout_ns) {
+      return;
+    }
+  }
+  if (active_command_source_.exchange(source) != (int)source) {
+    RCLCPP_INFO(get_logger(), "Velocity command source is now %s",
+                commander.name.c_str());
+  }
+
+  double speeddata[3];
+  speeddata[0] = std::clamp(msg->linear.x, -commander.linear_limit,
+                            commander.linear_limit);
+  speeddata[1] = std::clamp(msg->angular.z, -commander.angular_limit,
+                            commander.angular_limit);
+  speeddata[2] = msg->angular.y;
+  robot_->set_robot_velocity(speeddata);
+}
+
+rcl_interfaces::msg::SetParametersResult
+RobotDriver::parameters_event_callback(
+    const std::vector<rclcpp::Parameter> &parameters) {
+  rcl_interfaces::msg::SetParametersResult result;
+  result.successful = true;
+  // Merge into the running configuration so unset fields are kept
+  auto config = robot_->get_control_config();
+  bool changed = false;
+  bool schedule_changed = false;
+  for (auto &parameter : parameters) {
+    auto &name = parameter.get_name();
+    unsigned int field;
+    if (name == "motor_control_p_gain") {
+      field = Control::CONFIG_PID;
+      config.pid.kp = parameter.as_double();
+    } else if (name == "motor_control_i_gain") {
+      field = Control::CONFIG_PID;
+      config.pid.ki = parameter.as_double();
+    } else if (name == "motor_control_d_gain") {
+      field = Control::CONFIG_PID;
+      config.pid.kd = parameter.as_double();
+    } else if (name == "linear_acceleration_limit") {
+      field = Control::CONFIG_ACCELERATION_LIMITS;
+      config.acceleration_limits.linear_velocity = parameter.as_double();
+    } else if (name == "angular_acceleration_limit") {
+      field = Control::CONFIG_ACCELERATION_LIMITS;
+      config.acceleration_limits.angular_velocity = parameter.as_double();
+    } else if (name == "angular_a_coef") {
+      field = Control::CONFIG_ANGULAR_SCALING;
+      config.angular_scaling.a_coef = parameter.as_double();
+    } else if (name == "angular_b_coef") {
+      field = Control::CONFIG_ANGULAR_SCALING;
+      config.angular_scaling.b_coef = parameter.as_double();
+    } else if (name == "angular_c_coef") {
+      field = Control::CONFIG_ANGULAR_SCALING;
+      config.angular_scaling.c_coef = parameter.as_double();
+    } else if (name == "angular_min_scale") {
+      field = Control::CONFIG_ANGULAR_SCALING;
+      config.angular_scaling.min_scale_val = parameter.as_double();
+    } else if (name == "angular_max_scale") {
+      field = Control::CONFIG_ANGULAR_SCALING;
+      config.angular_scaling.max_scale_val = parameter.as_double();
+    } else if (name == "geometric_decay") {
+      field = Control::CONFIG_GEOMETRIC_DECAY;
+      config.geometric_decay = parameter.as_double();
+    } else if (name == "wheel_radius") {
+      field = Control::CONFIG_GEOMETRY;
+      config.geometry.wheel_radius = parameter.as_double();
+    } else if (name == "wheel_base") {
+      field = Control::CONFIG_GEOMETRY;
+      config.geometry.wheel_base = parameter.as_double();
+    } else if (name == "robot_length") {
+      field = Control::CONFIG_GEOMETRY;
+      config.geometry.intra_axle_distance = parameter.as_double();
+    } else if (name == "thermal_derating") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.enabled = parameter.as_bool();
+    } else if (name == "thermal_motor_limit") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.motor.limit = parameter.as_double();
+    } else if (name == "thermal_motor_time_constant") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.motor.time_constant = parameter.as_double();
+    } else if (name == "thermal_motor_heating_coef") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.motor.heating_coef = parameter.as_double();
+    } else if (name == "thermal_mosfet_limit") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.mosfet.limit = parameter.as_double();
+    } else if (name == "thermal_mosfet_time_constant") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.mosfet.time_constant = parameter.as_double();
+    } else if (name == "thermal_mosfet_heating_coef") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.mosfet.heating_coef = parameter.as_double();
+    } else if (name == "thermal_ambient") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.ambient = parameter.as_double();
+    } else if (name == "thermal_horizon") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.horizon = parameter.as_double();
+    } else if (name == "thermal_min_factor") {
+      field = Control::CONFIG_THERMAL;
+      config.thermal.min_factor = parameter.as_double();
+    } else if (name == "current_limiting") {
+      field = Control::CONFIG_CURRENT_LIMITS;
+      config.current_limits.enabled = parameter.as_bool();
+    } else if (name == "motor_current_budget") {
+      field = Control::CONFIG_CURRENT_LIMITS;
+      config.current_limits.motor_current_budget = parameter.as_double();
+    } else if (name == "battery_current_budget") {
+      field = Control::CONFIG_CURRENT_LIMITS;
+      config.current_limits.battery_current_budget = parameter.as_double();
+    } else if (name == "acceleration_max_boost") {
+      field = Control::CONFIG_CURRENT_LIMITS;
+      config.current_limits.max_boost = parameter.as_double();
+    } else if (name == "acceleration_min_scale") {
+      field = Control::CONFIG_CURRENT_LIMITS;
+      config.current_limits.min_scale = parameter.as_double();
+    } else if (name.rfind("gain_schedule_", 0) == 0) {
+      field = Control::CONFIG_GAIN_SCHEDULE;
+      schedule_changed = true;
+    } else {
+      continue;
+    }
+    if (!(robot_->supported_control_config() & field)) {
+      result.successful = false;
+      result.reason = name + " is fixed on the " + robot_type_;
+      RCLCPP_WARN(get_logger(), "Rejected parameter change: %s",
+                  result.reason.c_str());
+      return result;
+    }
+    changed = true;
+  }
+  if (!changed) return result;
+  if (schedule_changed) {
+    // The table spans several parameters; use the new value where one is set
+    auto value = [&](const std::string &name) {
+      for (auto &parameter : parameters) {
+        if (parameter.get_name() == name) return parameter.as_double_array();
+      }
+      return get_parameter(name).as_double_array();
+    };
+    config.schedule = make_gain_schedule(
+        value("gain_schedule_speeds"), value("gain_schedule_voltages"),
+        value("gain_schedule_p"), value("gain_schedule_i"),
+        value("gain_schedule_d"));
+  }
+
+  if (!Control::validateControlConfig(config, result.reason)) {
+    result.successful = false;
+    RCLCPP_WARN(get_logger(), "Rejected control configuration: %s",
+                result.reason.c_str());
+    return result;
+  }
+  robot_->update_control_config(config);
+  pid_gains_ = config.pid;
+  angular_scaling_params_ = config.angular_scaling;
+  wheel_radius_ = config.geometry.wheel_radius;
+  wheel_base_ = config.geometry.wheel_base;
+  robot_length_ = config.geometry.intra_axle_distance;
+  RCLCPP_INFO(get_logger(), "Control configuration updated; PID is at P:%.4f I:%.4f D:%.4f",
+              pid_gains_.kp, pid_gains_.ki, pid_gains_.kd);
+  return result;
+}
+
 void RobotDriver::trim_event_callback(
     std_msgs::msg::Float32::ConstSharedPtr &msg) {
   RCLCPP_INFO(get_logger(), "Trim Event triggered");
@@ -446,11 +1049,44 @@ void RobotDriver::robot_info_request_callback(
 int main(int argc, char **argv) {
   rclcpp::init(argc, argv);
 
-  rclcpp::executors::MultiThreadedExecutor executor;
-
   auto rover_node = std::make_shared<RobotDriver>();
-  executor.add_node(rover_node);
 
-  executor.spin();
+  // executor_threads only applies to multi_threaded; 0 = one per core
+  std::string executor_type =
+      rover_node->get_parameter("executor_type").as_string();
+  int executor_threads = rover_node->get_parameter("executor_threads").as_int();
+  std::unique_ptr<rclcpp::Executor> executor;
+  if (executor_type == "single_threaded") {
+    executor = std::make_unique<rclcpp::executors::SingleThreadedExecutor>();
+  } else if (executor_type == "static_single_threaded") {
+    executor =
+        std::make_unique<rclcpp::executors::StaticSingleThreadedExecutor>();
+  } else if (executor_type == "events") {
+#ifdef ROVER_HAS_EVENTS_EXECUTOR
+    executor =
+        std::make_unique<rclcpp::experimental::executors::EventsExecutor>();
+#else
+    RCLCPP_WARN(rover_node->get_logger(),
+                "This rclcpp has no EventsExecutor, using "
+                "static_single_threaded");
+    executor_type = "static_single_threaded";
+    executor =
+        std::make_unique<rclcpp::executors::StaticSingleThreadedExecutor>();
+#endif
+  } else {
+    if (executor_type != "multi_threaded") {
+      RCLCPP_WARN(rover_node->get_logger(),
+                  "Unknown executor_type %s, using multi_threaded",
+                  executor_type.c_str());
+      executor_type = "multi_threaded";
+    }
+    executor = std::make_unique<rclcpp::executors::MultiThreadedExecutor>(
+        rclcpp::ExecutorOptions(), std::max(0, executor_threads));
+  }
+  RCLCPP_INFO(rover_node->get_logger(), "Spinning with the %s executor",
+              executor_type.c_str());
+  executor->add_node(rover_node);
+
+  executor->spin();
   return 0;
 }
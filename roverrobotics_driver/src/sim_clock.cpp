@@ -0,0 +1,63 @@
+// /clock publisher for the simulated robot.
+//
+// With use_sim_time the driver and librover's control loops follow /clock.
+// The simulated robot has no physics engine to publish it, so this node
+// advances sim time by a fixed step on a wall timer:
+//   real_time_factor  sim seconds per wall second (1.0 = real time)
+//   step              sim seconds per /clock message
+// Sim time starts at the wall time; the node itself runs on the wall clock.
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rosgraph_msgs/msg/clock.hpp"
+
+namespace {
+class SimClock : public rclcpp::Node {
+ public:
+  SimClock() : Node("sim_clock") {
+    declare_parameter("real_time_factor", 1.0);
+    declare_parameter("step", 0.001);
+    double real_time_factor = get_parameter("real_time_factor").as_double();
+    double step = get_parameter("step").as_double();
+    if (real_time_factor <= 0 || step <= 0) {
+      RCLCPP_FATAL(get_logger(), "real_time_factor and step must be > 0");
+      throw(-1);
+    }
+    step_ns_ = static_cast<int64_t>(step * 1e9);
+    // start at the wall time; zero reads as "no time yet" in ROS
+    now_ns_ = get_clock()->now().nanoseconds();
+
+    clock_pub_ = create_publisher<rosgraph_msgs::msg::Clock>(
+        "/clock", rclcpp::ClockQoS());
+    timer_ = create_wall_timer(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::duration<double>(step / real_time_factor)),
+        [this]() { publish_clock(); });
+    RCLCPP_INFO(get_logger(), "Publishing /clock at %.2fx real time",
+                real_time_factor);
+  }
+
+ private:
+  void publish_clock() {
+    rosgraph_msgs::msg::Clock msg;
+    msg.clock = rclcpp::Time(now_ns_, RCL_ROS_TIME);
+    clock_pub_->publish(msg);
+    now_ns_ += step_ns_;
+  }
+
+  int64_t step_ns_;
+  int64_t now_ns_;
+  rclcpp::Publisher<rosgraph_msgs::msg::Clock>::SharedPtr clock_pub_;
+  rclcpp::TimerBase::SharedPtr timer_;
+};
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  rclcpp::init(argc, argv);
+  rclcpp::spin(std::make_shared<SimClock>());
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,423 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <thread>
+
+#include "control.hpp"
+
+using namespace Control;
+
+namespace {
+robot_geometry testGeometry() {
+  return {.intra_axle_distance = 0.2159,
+          .wheel_base = 0.28575,
+          .wheel_radius = 0.08255,
+          .center_of_mass_x_offset = 0,
+          .center_of_mass_y_offset = 0};
+}
+
+std::unique_ptr<SkidRobotMotionController> makeController() {
+  auto controller = std::make_unique<SkidRobotMotionController>(
+      INDEPENDENT_WHEEL, testGeometry(), pid_gains{0.01, 0, 0}, 0.97, 0.02, 1,
+      1, 0.98);
+  controller->setOperatingMode(INDEPENDENT_WHEEL);
+  return controller;
+}
+
+void runCycle(SkidRobotMotionController &controller) {
+  controller.runMotionControl({0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0});
+}
+}  // namespace
+
+TEST(ControlConfigTest, ReportsSetupValues) {
+  auto controller_ptr = makeController();
+  auto &controller = *controller_ptr;
+  auto config = controller.getControlConfig();
+  EXPECT_DOUBLE_EQ(config.pid.kp, 0.01);
+  EXPECT_FLOAT_EQ(config.geometry.wheel_base, 0.28575);
+  EXPECT_FLOAT_EQ(config.geometric_decay, 0.98);
+}
+
+TEST(ControlConfigTest, MergeRoundTripKeepsEarlierChanges) {
+  auto controller_ptr = makeController();
+  auto &controller = *controller_ptr;
+
+  auto config = controller.getControlConfig();
+  config.pid.kp = 0.02;
+  config.schedule.speed_breakpoints = {0, 1};
+  config.schedule.voltage_breakpoints = {24};
+  config.schedule.gains = {{0.02, 0, 0}, {0.03, 0, 0}};
+  std::string reason;
+  ASSERT_TRUE(validateControlConfig(config, reason)) << reason;
+  controller.setControlConfig(config);
+
+  // staged but not applied yet: a second change merges on top of the first
+  config = controller.getControlConfig();
+  EXPECT_DOUBLE_EQ(config.pid.kp, 0.02);
+  config.geometry.wheel_base = 0.3;
+  controller.setControlConfig(config);
+
+  runCycle(controller);
+  config = controller.getControlConfig();
+  EXPECT_DOUBLE_EQ(config.pid.kp, 0.02);
+  EXPECT_FLOAT_EQ(config.geometry.wheel_base, 0.3);
+  EXPECT_EQ(config.schedule.gains.size(), 2u);
+  EXPECT_FLOAT_EQ(controller.getRobotGeometry().wheel_base, 0.3);
+  EXPECT_DOUBLE_EQ(controller.getPidGains().kp, 0.02);
+
+  // after it is applied, the next merge starts from the applied config
+  config.geometric_decay = 0.9;
+  controller.setControlConfig(config);
+  runCycle(controller);
+  config = controller.getControlConfig();
+  EXPECT_FLOAT_EQ(config.geometric_decay, 0.9);
+  EXPECT_FLOAT_EQ(config.geometry.wheel_base, 0.3);
+  EXPECT_DOUBLE_EQ(config.pid.kp, 0.02);
+}
+
+TEST(ControlConfigTest, ConcurrentReadsNeverSeeAMix) {
+  auto controller_ptr = makeController();
+  auto &controller = *controller_ptr;
+  auto a = controller.getControlConfig();
+  auto b = a;
+  // geometric_decay tags each config
+  a.geometric_decay = 0.5;
+  a.geometry.wheel_base = 0.1;
+  b.geometric_decay = 0.6;
+  b.geometry.wheel_base = 0.2;
+
+  std::atomic<bool> done{false};
+  std::thread control([&] {
+    while (!done) runCycle(controller);
+  });
+  for (int i = 0; i < 2000; i++) {
+    controller.setControlConfig(i % 2 ? a : b);
+    auto config = controller.getControlConfig();
+    if (config.geometric_decay == 0.5f) {
+      EXPECT_FLOAT_EQ(config.geometry.wheel_base, 0.1);
+    } else if (config.geometric_decay == 0.6f) {
+      EXPECT_FLOAT_EQ(config.geometry.wheel_base, 0.2);
+    }
+  }
+  done = true;
+  control.join();
+}
+
+TEST(DelayCompensationTest, TogglesWhileTheControlLoopRuns) {
+  auto controller_ptr = makeController();
+  auto &controller = *controller_ptr;
+  std::atomic<bool> done{false};
+  std::thread control([&] {
+    while (!done) runCycle(controller);
+  });
+  for (int i = 0; i < 2000; i++) {
+    controller.setDelayCompensation(i % 2);
+    controller.setMeasurementDelay(0.001 * (i % 50));
+  }
+  done = true;
+  control.join();
+  // the last toggle (i = 1999) wins
+  EXPECT_TRUE(controller.getDelayCompensation());
+  EXPECT_FLOAT_EQ(controller.getMeasurementDelay(), 0.049);
+}
+
+TEST(LatencyEstimatorTest, UnknownUntilTheFirstReply) {
+  LatencyEstimator latency;
+  EXPECT_EQ(latency.getRoundTripMs(), 0);
+  EXPECT_TRUE(std::isinf(latency.getTelemetryAgeMs()));
+  EXPECT_EQ(latency.getMeasurementDelay(), 0);
+}
+
+TEST(LatencyEstimatorTest, TimesTheOldestOutstandingRequest) {
+  LatencyEstimator latency(1.0);
+  latency.markRequest();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  latency.markRequest();
+  latency.markReply();
+  EXPECT_GE(latency.getRoundTripMs(), 20);
+
+  // a reply with no request outstanding only refreshes the telemetry age
+  float round_trip = latency.getRoundTripMs();
+  latency.markReply();
+  EXPECT_EQ(latency.getRoundTripMs(), round_trip);
+  EXPECT_LT(latency.getTelemetryAgeMs(), 20);
+  EXPECT_GE(latency.getMeasurementDelay(), round_trip / 2 / 1000);
+}
+
+TEST(DelayCompensatorTest, HeldSampleKeepsItsSlope) {
+  DelayCompensator compensator(0.25, 1.0);
+  compensator.predict(0, 1, 0.01, 0.1);
+  EXPECT_FLOAT_EQ(compensator.predict(1, 2, 0.01, 0.1), 1 + 100 * 0.1);
+  // the same sample seen again by a faster control loop
+  EXPECT_FLOAT_EQ(compensator.predict(1, 2, 0.01, 0.1), 1 + 100 * 0.1);
+}
+
+TEST(DelayCompensatorTest, RepeatedValueIsANewSample) {
+  DelayCompensator compensator(0.25, 1.0);
+  compensator.predict(0, 1, 0.01, 0.1);
+  compensator.predict(1, 2, 0.01, 0.1);
+  // the wheel stopped accelerating; same value, new sequence
+  EXPECT_FLOAT_EQ(compensator.predict(1, 3, 0.01, 0.1), 1);
+}
+
+TEST(DelayCompensatorTest, FirstSampleAfterResetHasNoSlope) {
+  DelayCompensator compensator;
+  compensator.predict(0, 1, 0.01, 0.1);
+  compensator.predict(1, 2, 0.01, 0.1);
+  compensator.reset();
+  EXPECT_FLOAT_EQ(compensator.predict(5, 3, 0.01, 0.1), 5);
+}
+
+TEST(DelayCompensatorTest, SmoothsNoisySlopes) {
+  DelayCompensator raw(0.25, 1.0);
+  DelayCompensator smoothed(0.25, 0.3);
+  float raw_error = 0, smoothed_error = 0;
+  for (unsigned int i = 1; i <= 100; i++) {
+    // constant speed with +-0.05 of alternating noise
+    float measured = 1 + (i % 2 ? 0.05f : -0.05f);
+    raw_error = std::max(raw_error,
+                         std::abs(raw.predict(measured, i, 0.01, 0.1) - 1));
+    smoothed_error =
+        std::max(smoothed_error,
+                 std::abs(smoothed.predict(measured, i, 0.01, 0.1) - 1));
+  }
+  EXPECT_LT(smoothed_error, raw_error / 2);
+}
+
+TEST(DelayCompensatorTest, ClampsTheDelay) {
+  DelayCompensator compensator(0.1, 1.0);
+  compensator.predict(0, 1, 0.01, 0);
+  EXPECT_FLOAT_EQ(compensator.predict(1, 2, 0.01, 10), 1 + 100 * 0.1);
+  EXPECT_FLOAT_EQ(compensator.predict(1, 2, 0, -1), 1);
+}
+
+TEST(YawRateFusionTest, LearnsTheTractionFactor) {
+  YawRateFusion fusion(0.98, 0.1);
+  for (int i = 0; i < 200; i++) fusion.update(0.6, 1.0, 0.5);
+  EXPECT_NEAR(fusion.getTractionFactor(), 0.6, 1e-3);
+  EXPECT_NEAR(fusion.correctWheelYawRate(-1.0), -0.6, 1e-3);
+}
+
+TEST(YawRateFusionTest, LearnsTheGyroBiasAtStandstill) {
+  YawRateFusion fusion(1.0, 0.1);
+  for (int i = 0; i < 200; i++) fusion.update(0.02, 0, 0);
+  EXPECT_NEAR(fusion.getGyroBias(), 0.02, 1e-4);
+  EXPECT_NEAR(fusion.update(0.52, 0.5, 0.5), 0.5, 1e-3);
+}
+
+TEST(YawRateFusionTest, IgnoresDisagreeingOrSlowTurns) {
+  YawRateFusion fusion(0.98, 0.5);
+  fusion.update(-0.5, 0.5, 0.5);
+  fusion.update(0.05, 0.5, 0.5);
+  fusion.update(0.5, 0.05, 0.5);
+  EXPECT_FLOAT_EQ(fusion.getTractionFactor(), 1.0);
+}
+
+TEST(GainScheduleTest, InterpolatesBilinearly) {
+  // gains are speed-major: (0 m/s, 20 V), (0, 30), (1, 20), (1, 30)
+  gain_schedule schedule = {
+      {0, 1}, {20, 30}, {{1, 0, 0}, {2, 0, 0}, {3, 0, 0}, {4, 0.4, 0.04}}};
+  EXPECT_DOUBLE_EQ(interpolateGains(schedule, 0, 20).kp, 1);
+  EXPECT_DOUBLE_EQ(interpolateGains(schedule, 1, 30).ki, 0.4);
+  EXPECT_NEAR(interpolateGains(schedule, 0.5, 25).kp, 2.5, 1e-6);
+  EXPECT_NEAR(interpolateGains(schedule, 0.5, 30).kd, 0.02, 1e-6);
+}
+
+TEST(GainScheduleTest, ClampsToTheTableEdges) {
+  gain_schedule schedule = {
+      {0, 1}, {20, 30}, {{1, 0, 0}, {2, 0, 0}, {3, 0, 0}, {4, 0, 0}}};
+  EXPECT_DOUBLE_EQ(interpolateGains(schedule, 5, 40).kp, 4);
+  EXPECT_DOUBLE_EQ(interpolateGains(schedule, -1, 10).kp, 1);
+  // no voltage reported yet: the highest breakpoint
+  EXPECT_DOUBLE_EQ(interpolateGains(schedule, 0, 0).kp, 2);
+}
+
+TEST(GainScheduleTest, SingleEntryIsConstant) {
+  gain_schedule schedule = {{0}, {24}, {{0.01, 0.02, 0.03}}};
+  auto gains = interpolateGains(schedule, 3, 12);
+  EXPECT_DOUBLE_EQ(gains.kp, 0.01);
+  EXPECT_DOUBLE_EQ(gains.ki, 0.02);
+  EXPECT_DOUBLE_EQ(gains.kd, 0.03);
+}
+
+namespace {
+drive_telemetry thermalTelemetry(float current, float temperature) {
+  drive_telemetry telemetry = {0};
+  telemetry.battery_voltage = 24;
+  telemetry.motor_currents = {current, current, current, current};
+  telemetry.motor_temperatures = {temperature, temperature, temperature,
+                                  temperature};
+  telemetry.mosfet_temperatures = {NAN, NAN, NAN, NAN};
+  return telemetry;
+}
+}  // namespace
+
+TEST(ThermalDeratingTest, IdleRobotIsNotDerated) {
+  ThermalDerating derating(defaultThermalDeratingParams());
+  for (int i = 0; i < 100; i++) derating.update(thermalTelemetry(0, 30), 0.1);
+  EXPECT_FLOAT_EQ(derating.getDerateFactor(), 1);
+  EXPECT_TRUE(std::isinf(derating.getTimeToLimit()));
+}
+
+TEST(ThermalDeratingTest, SlowsAheadOfTheLimit) {
+  auto params = defaultThermalDeratingParams();
+  ThermalDerating derating(params);
+  // 60 A settles far above the 85 C limit; only the time to get there is left
+  float factor = 1;
+  for (int i = 0; i < 1200; i++) {
+    factor = derating.update(thermalTelemetry(60, NAN), 0.1);
+  }
+  EXPECT_LT(derating.getTimeToLimit(), params.horizon);
+  EXPECT_LT(factor, 1);
+  EXPECT_GE(factor, params.min_factor);
+}
+
+TEST(ThermalDeratingTest, MeasuredOverTemperatureGoesToTheFloor) {
+  auto params = defaultThermalDeratingParams();
+  ThermalDerating derating(params);
+  for (int i = 0; i < 200; i++) derating.update(thermalTelemetry(10, 95), 0.1);
+  EXPECT_EQ(derating.getTimeToLimit(), 0);
+  EXPECT_NEAR(derating.getDerateFactor(), params.min_factor, 1e-3);
+}
+
+TEST(ThermalDeratingTest, SurvivesAnUnrelatedConfigChange) {
+  auto controller = makeController();
+  auto config = controller->getControlConfig();
+  config.thermal.enabled = true;
+  controller->setControlConfig(config);
+  controller->setDriveTelemetry(thermalTelemetry(10, 95));
+  for (int i = 0; i < 20; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    runCycle(*controller);
+  }
+  float factor = controller->getThermalDerateFactor();
+  ASSERT_LT(factor, 1);
+
+  // a live PID change must not reset the derating of a hot motor
+  config = controller->getControlConfig();
+  config.pid.kp = 0.02;
+  controller->setControlConfig(config);
+  runCycle(*controller);
+  EXPECT_LE(controller->getThermalDerateFactor(), factor);
+}
+
+TEST(ThermalModelTest, UnknownCurrentKeepsTheRecentLoad) {
+  ThermalModel model({.time_constant = 10, .heating_coef = 0.05, .limit = 85});
+  for (int i = 0; i < 100; i++) model.update(40, NAN, 0.1);
+  float temperature = model.getTemperature();
+  model.update(NAN, NAN, 0.1);
+  EXPECT_GT(model.getTemperature(), temperature);
+}
+
+namespace {
+current_limit_params testCurrentLimits() {
+  auto params = defaultCurrentLimitParams();
+  params.enabled = true;
+  return params;
+}
+
+drive_telemetry currentTelemetry(float motor_current, float battery_current) {
+  drive_telemetry telemetry = thermalTelemetry(motor_current, NAN);
+  telemetry.battery_current = battery_current;
+  return telemetry;
+}
+}  // namespace
+
+TEST(CurrentLimiterTest, BoostsWithHeadroomUpToTheMax) {
+  auto params = testCurrentLimits();
+  CurrentLimiter limiter(params);
+  for (int i = 0; i < 100; i++) limiter.update(currentTelemetry(1, 2), 0.05);
+  EXPECT_NEAR(limiter.getScale(), params.max_boost, 1e-3);
+}
+
+TEST(CurrentLimiterTest, CutsBackOverBudget) {
+  auto params = testCurrentLimits();
+  CurrentLimiter limiter(params);
+  // motors at twice their budget; quick attack
+  limiter.update(currentTelemetry(2 * params.motor_current_budget, 0), 0.05);
+  EXPECT_LT(limiter.getScale(), 1);
+  for (int i = 0; i < 100; i++) {
+    limiter.update(currentTelemetry(2 * params.motor_current_budget, 0), 0.05);
+  }
+  // settles where the draw would meet the budget, without compounding
+  EXPECT_NEAR(limiter.getScale(), 0.5, 1e-3);
+  for (int i = 0; i < 100; i++) {
+    limiter.update(currentTelemetry(10 * params.motor_current_budget, 0), 0.05);
+  }
+  EXPECT_FLOAT_EQ(limiter.getScale(), params.min_scale);
+}
+
+TEST(CurrentLimiterTest, RelaxesWithoutTelemetry) {
+  CurrentLimiter limiter(testCurrentLimits());
+  for (int i = 0; i < 100; i++) limiter.update(currentTelemetry(1, 2), 0.05);
+  for (int i = 0; i < 100; i++) limiter.update(currentTelemetry(NAN, 2), 0.05);
+  EXPECT_NEAR(limiter.getScale(), 1, 1e-3);
+}
+
+TEST(CurrentLimiterTest, DoesNotBoostAtStandstill) {
+  CurrentLimiter limiter(testCurrentLimits());
+  for (int i = 0; i < 100; i++) limiter.update(currentTelemetry(0, 0), 0.05);
+  EXPECT_FLOAT_EQ(limiter.getScale(), 1);
+}
+
+TEST(CurrentLimiterTest, IdleControllerStartsAtTheConfiguredLimit) {
+  auto controller = makeController();
+  auto config = controller->getControlConfig();
+  config.current_limits = testCurrentLimits();
+  controller->setControlConfig(config);
+  controller->setDriveTelemetry(currentTelemetry(0, 0));
+  for (int i = 0; i < 50; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    runCycle(*controller);
+  }
+  // the first acceleration from rest uses the unboosted limit
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  controller->runMotionControl({0.5, 0}, {0, 0, 0, 0}, {0, 0, 0, 0});
+  EXPECT_LE(controller->getAccelerationScale(), 1);
+}
+
+TEST(CurrentLimiterTest, BoostsAnUnlimitedAccelerationLimit) {
+  auto controller = makeController();
+  auto config = controller->getControlConfig();
+  config.current_limits = testCurrentLimits();
+  controller->setControlConfig(config);
+  controller->setDriveTelemetry(currentTelemetry(1, 2));
+  motor_data duty = {0, 0, 0, 0};
+  for (int i = 0; i < 50; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    duty = controller->runMotionControl({0.5, 0}, {0, 0, 0, 0}, {0, 0, 0, 0});
+  }
+  EXPECT_GT(controller->getAccelerationScale(), 1);
+  EXPECT_TRUE(std::isfinite(duty.fl) && std::isfinite(duty.fr) &&
+              std::isfinite(duty.rl) && std::isfinite(duty.rr));
+}
+
+TEST(SigmaDeltaQuantizerTest, AverageTracksAFractionalCommand) {
+  SigmaDeltaQuantizer quantizer(0, 250);
+  int sum = 0;
+  for (int i = 0; i < 100; i++) sum += quantizer.quantize(125.3);
+  EXPECT_NEAR(sum / 100.0, 125.3, 0.01);
+}
+
+TEST(SigmaDeltaQuantizerTest, OutputsAdjacentSteps) {
+  SigmaDeltaQuantizer quantizer(0, 250);
+  for (int i = 0; i < 50; i++) {
+    int output = quantizer.quantize(125.5);
+    EXPECT_TRUE(output == 125 || output == 126) << output;
+  }
+}
+
+TEST(SigmaDeltaQuantizerTest, SaturationDoesNotWindUp) {
+  SigmaDeltaQuantizer quantizer(0, 250);
+  for (int i = 0; i < 100; i++) EXPECT_EQ(quantizer.quantize(300), 250);
+  // a long stretch above max leaves at most one step of error behind
+  EXPECT_LE(std::abs(quantizer.quantize(125) - 125), 1);
+  EXPECT_EQ(quantizer.quantize(125), 125);
+}
+
+TEST(SigmaDeltaQuantizerTest, ResetDropsTheError) {
+  SigmaDeltaQuantizer quantizer(0, 250);
+  quantizer.quantize(125.4);
+  quantizer.reset();
+  EXPECT_EQ(quantizer.quantize(125), 125);
+}
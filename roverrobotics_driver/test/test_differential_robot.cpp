@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include "differential_robot.hpp"
+
+using namespace RoverRobotics;
+
+namespace {
+// stands in for the serial port; frames are fed to unpack_comm_response
+class FakeComm : public CommBase {
+ public:
+  void write_to_device(std::vector<uint8_t>) override {}
+  void read_device_loop(std::function<void(std::vector<uint8_t>)>) override {}
+  bool is_connected() override { return true; }
+};
+
+// manually advanced clock for the robot's RoverClock
+std::atomic<int64_t> fake_now_ns{0};
+
+void useFakeClock() {
+  Utilities::RoverClock::set_time_source(
+      {[] { return fake_now_ns.load(); },
+       [](int64_t) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         return true;
+       }});
+}
+
+void put16(std::vector<uint8_t> &frame, size_t at, int16_t value) {
+  frame[at] = static_cast<uint16_t>(value) >> 8;
+  frame[at + 1] = static_cast<uint16_t>(value) & 0xFF;
+}
+
+void put32(std::vector<uint8_t> &frame, size_t at, int32_t value) {
+  for (int byte = 0; byte < 4; byte++)
+    frame[at + byte] = static_cast<uint32_t>(value) >> (24 - 8 * byte);
+}
+
+// COMM_GET_VALUES reply of one VESC: start, length, command, 72 bytes of
+// values, crc (not checked by the decoder), stop
+std::vector<uint8_t> getValuesFrame(uint8_t vesc_id, int32_t erpm,
+                                    int16_t voltage_dv) {
+  const uint8_t length = 73;
+  std::vector<uint8_t> frame(length + 5, 0);
+  frame[0] = 2;
+  frame[1] = length;
+  frame[2] = COMM_GET_VALUES;
+  put16(frame, 3, 300);    // fet temp, 0.1 C
+  put16(frame, 5, 250);    // motor temp, 0.1 C
+  put32(frame, 15, 120);   // input current, 0.01 A
+  put32(frame, 25, erpm);
+  put16(frame, 29, voltage_dv);
+  frame[60] = vesc_id;
+  frame[length + 4] = 3;
+  return frame;
+}
+
+std::unique_ptr<DifferentialRobot> makeSerialRobot() {
+  return std::make_unique<DifferentialRobot>(
+      std::make_unique<FakeComm>(), "serial", 0.08255, 0.28575, 0.2159,
+      Control::pid_gains{0, 0, 0},
+      Control::angular_scaling_params{0, 0, 0, 1, 1});
+}
+}  // namespace
+
+class DifferentialRobotSerialTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    setenv("HOME", ::testing::TempDir().c_str(), 1);
+    fake_now_ns = 1000000000;
+    useFakeClock();
+  }
+  void TearDown() override { Utilities::RoverClock::reset_time_source(); }
+};
+
+TEST_F(DifferentialRobotSerialTest, ValidFrameStampsMotorAndBattery) {
+  auto robot = makeSerialRobot();
+  auto before = robot->status_request();
+  EXPECT_EQ(before.motor1_stamp.sequence, 0u);
+  EXPECT_EQ(before.battery1_stamp.sequence, 0u);
+
+  robot->unpack_comm_response(getValuesFrame(FRONT_LEFT, 1500, 400));
+  auto after = robot->status_request();
+  EXPECT_EQ(after.motor1_stamp.sequence, 1u);
+  EXPECT_EQ(after.motor1_stamp.time, std::chrono::milliseconds(1000));
+  EXPECT_EQ(after.battery1_stamp.sequence, 1u);
+  EXPECT_EQ(after.motor1_temp_stamp.sequence, 1u);
+  EXPECT_EQ(after.motor2_stamp.sequence, 0u);
+  EXPECT_EQ(after.motor2_temp_stamp.sequence, 0u);
+  EXPECT_FLOAT_EQ(after.motor1_rpm, 1500 * VESC_RPM_SCALING_FACTOR);
+  EXPECT_FLOAT_EQ(after.battery1_voltage, 40.0);
+
+  fake_now_ns = 1050000000;
+  robot->unpack_comm_response(getValuesFrame(FRONT_LEFT, 1500, 400));
+  robot->unpack_comm_response(getValuesFrame(BACK_RIGHT, -1500, 400));
+  after = robot->status_request();
+  EXPECT_EQ(after.motor1_stamp.sequence, 2u);
+  EXPECT_EQ(after.motor1_stamp.time, std::chrono::milliseconds(1050));
+  EXPECT_EQ(after.motor4_stamp.sequence, 1u);
+  EXPECT_EQ(after.battery1_stamp.sequence, 3u);
+  EXPECT_FALSE(is_stale(after.motor1_stamp, std::chrono::milliseconds(1100),
+                        std::chrono::milliseconds(200)));
+}
+
+namespace {
+// CAN frame of one VESC as handed to parseReceivedMessage: extended id
+// (command << 8 | vesc id), then the payload from byte 5
+std::vector<uint8_t> canFrame(uint8_t command, uint8_t vesc_id) {
+  std::vector<uint8_t> frame(16, 0);
+  put32(frame, 0, (command << 8) | vesc_id);
+  return frame;
+}
+}  // namespace
+
+TEST(VescDecoderTest, TemperaturesAreUnknownUntilStatus4) {
+  vesc::BridgedVescArray vescs({1});
+  auto status =
+      vescs.parseReceivedMessage(canFrame(vesc::STATUS_COMMAND_ID, 1));
+  ASSERT_TRUE(status.dataValid);
+  EXPECT_TRUE(std::isnan(status.temp_motor));
+  EXPECT_TRUE(std::isnan(status.temp_fet));
+
+  // a real 0 C reading is reported as such
+  auto status_4 = canFrame(vesc::STATUS_COMMAND_ID_4, 1);
+  put16(status_4, 5, 0);
+  put16(status_4, 7, 0);
+  vescs.parseReceivedMessage(status_4);
+  status = vescs.parseReceivedMessage(canFrame(vesc::STATUS_COMMAND_ID, 1));
+  EXPECT_FLOAT_EQ(status.temp_motor, 0);
+  EXPECT_FLOAT_EQ(status.temp_fet, 0);
+}
+
+TEST(FieldStampTest, NeverReceivedIsStaleButNotLost) {
+  field_stamp stamp = {std::chrono::milliseconds(0), 0};
+  auto now = std::chrono::milliseconds(10);
+  EXPECT_TRUE(is_stale(stamp, now, std::chrono::milliseconds(200)));
+  EXPECT_FALSE(is_lost(stamp, now, std::chrono::milliseconds(200)));
+}
+
+TEST(FieldStampTest, StaleAndLostAfterTheTimeout) {
+  field_stamp stamp = {std::chrono::milliseconds(0), 0};
+  stamp_field(stamp, std::chrono::milliseconds(1000));
+  EXPECT_EQ(stamp.sequence, 1u);
+  auto timeout = std::chrono::milliseconds(200);
+  EXPECT_FALSE(is_stale(stamp, std::chrono::milliseconds(1200), timeout));
+  EXPECT_FALSE(is_lost(stamp, std::chrono::milliseconds(1200), timeout));
+  EXPECT_TRUE(is_stale(stamp, std::chrono::milliseconds(1201), timeout));
+  EXPECT_TRUE(is_lost(stamp, std::chrono::milliseconds(1201), timeout));
+
+  stamp_field(stamp, std::chrono::milliseconds(1201));
+  EXPECT_EQ(stamp.sequence, 2u);
+  EXPECT_FALSE(is_stale(stamp, std::chrono::milliseconds(1300), timeout));
+}
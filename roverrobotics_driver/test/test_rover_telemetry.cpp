@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "rover_telemetry.h"
+#include "telemetry_exporter.hpp"
+
+namespace {
+// a segment per test process so parallel runs do not share one
+std::string segmentName() {
+  return "/rover_telemetry_test_" + std::to_string(getpid());
+}
+
+// every field follows from n, so a torn copy shows up as a mismatch
+rover_telemetry_snapshot makeSnapshot(uint64_t n) {
+  rover_telemetry_snapshot snapshot = {};
+  snapshot.sequence = n;
+  snapshot.stamp_ns = n * 1000;
+  for (int i = 0; i < 4; i++) snapshot.motor_rpm[i] = n;
+  snapshot.linear_vel = n;
+  snapshot.acceleration_scale = n;
+  return snapshot;
+}
+}  // namespace
+
+TEST(RoverTelemetryTest, OpenFailsWithoutAWriter) {
+  EXPECT_EQ(rover_telemetry_open("/rover_telemetry_test_missing"), nullptr);
+}
+
+TEST(RoverTelemetryTest, ReadsWhatWasWritten) {
+  auto name = segmentName();
+  rover_telemetry *writer = rover_telemetry_create(name.c_str());
+  ASSERT_NE(writer, nullptr);
+  rover_telemetry *reader = rover_telemetry_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+
+  rover_telemetry_snapshot snapshot;
+  EXPECT_EQ(rover_telemetry_read(reader, &snapshot), -1);
+
+  auto written = makeSnapshot(7);
+  rover_telemetry_write(writer, &written);
+  ASSERT_EQ(rover_telemetry_read(reader, &snapshot), 0);
+  EXPECT_EQ(snapshot.sequence, 7u);
+  EXPECT_EQ(snapshot.stamp_ns, 7000);
+  EXPECT_FLOAT_EQ(snapshot.motor_rpm[3], 7);
+
+  rover_telemetry_close(reader);
+  rover_telemetry_destroy(writer);
+  EXPECT_EQ(rover_telemetry_open(name.c_str()), nullptr);
+}
+
+TEST(RoverTelemetryTest, ConcurrentReadsAreNeverTorn) {
+  auto name = segmentName();
+  rover_telemetry *writer = rover_telemetry_create(name.c_str());
+  ASSERT_NE(writer, nullptr);
+  rover_telemetry *reader = rover_telemetry_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+
+  std::atomic<bool> done{false};
+  std::thread write([&] {
+    for (uint64_t n = 1; !done; n++) {
+      auto snapshot = makeSnapshot(n);
+      rover_telemetry_write(writer, &snapshot);
+    }
+  });
+  int reads = 0;
+  while (reads < 10000) {
+    rover_telemetry_snapshot snapshot;
+    if (rover_telemetry_read(reader, &snapshot) != 0) continue;
+    reads++;
+    ASSERT_EQ(snapshot.stamp_ns, int64_t(snapshot.sequence * 1000));
+    ASSERT_EQ(snapshot.motor_rpm[0], float(snapshot.sequence));
+    ASSERT_EQ(snapshot.linear_vel, double(snapshot.sequence));
+  }
+  done = true;
+  write.join();
+
+  rover_telemetry_close(reader);
+  rover_telemetry_destroy(writer);
+}
+
+TEST(RoverTelemetryTest, ExporterRejectsANonPositiveFrequency) {
+  auto name = segmentName();
+  EXPECT_THROW(RoverRobotics::TelemetryExporter(nullptr, name, 0), int);
+  EXPECT_THROW(RoverRobotics::TelemetryExporter(nullptr, name, -10), int);
+  EXPECT_EQ(rover_telemetry_open(name.c_str()), nullptr);
+}
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include "utilities.hpp"
+
+using Utilities::RoverClock;
+
+namespace {
+class RoverClockTest : public ::testing::Test {
+ protected:
+  void TearDown() override { RoverClock::reset_time_source(); }
+};
+}  // namespace
+
+TEST_F(RoverClockTest, SteadyClockSleepsAndContinues) {
+  auto start = RoverClock::now();
+  EXPECT_TRUE(RoverClock::sleep_for(std::chrono::milliseconds(2)));
+  EXPECT_GE(RoverClock::now() - start, std::chrono::milliseconds(2));
+}
+
+TEST_F(RoverClockTest, FollowsTheTimeSource) {
+  int64_t slept_until = 0;
+  RoverClock::set_time_source({[] { return int64_t{5000000}; },
+                               [&slept_until](int64_t time) {
+                                 slept_until = time;
+                                 return true;
+                               }});
+  EXPECT_EQ(RoverClock::now().time_since_epoch().count(), 5000000);
+  EXPECT_TRUE(RoverClock::sleep_for(std::chrono::milliseconds(1)));
+  EXPECT_EQ(slept_until, 6000000);
+}
+
+TEST_F(RoverClockTest, StoppedTimeSourceStopsTheLoop) {
+  RoverClock::set_time_source(
+      {[] { return int64_t{0}; }, [](int64_t) { return false; }});
+  int cycles = 0;
+  while (RoverClock::sleep_for(std::chrono::milliseconds(1))) cycles++;
+  EXPECT_EQ(cycles, 0);
+
+  RoverClock::reset_time_source();
+  EXPECT_TRUE(RoverClock::sleep_for(std::chrono::milliseconds(0)));
+}